@@ -0,0 +1,263 @@
+//
+// ECB - benchmark of the build phases
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Times each phase of a build separately on the configurations in
+// scripts/yaml and on the synthetic fixtures in bench/fixtures, and writes
+// the results as JSON. Run it from the directory `bin`, like the unit tests:
+//
+//   ./ecb_bench [--iterations N] [--output FILE]
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "yj_cfg.h"
+#include "yj_common.h"
+#include "yj_render.h"
+#include "yj_schema.h"
+#include "yj_yaml.h"
+
+using nlohmann::json;
+
+// configuration that is benchmarked
+struct BenchInput
+{
+    std::string filename_yaml;
+    std::string schema;
+};
+
+// durations of one phase in microseconds, in the order of the iterations
+struct BenchPhase
+{
+    std::string name;
+    std::vector<double> samples;
+};
+
+static const std::string corpus_dir = "../scripts/yaml/";
+static const std::string fixtures_dir = "../bench/fixtures/";
+static const std::string filename_schema = fixtures_dir + "schema.json";
+static const std::string template_dir = fixtures_dir + "templates";
+
+static const std::vector<BenchInput> inputs =
+{
+    {corpus_dir + "pax0.yaml", "axis"},
+    {corpus_dir + "pax1.yaml", "axis"},
+    {corpus_dir + "pax2.yaml", "axis"},
+    {corpus_dir + "pax3.yaml", "axis"},
+    {corpus_dir + "pax4.yaml", "axis"},
+    {corpus_dir + "pax5.yaml", "axis"},
+    {corpus_dir + "pax6.yaml", "axis"},
+    {corpus_dir + "pax7.yaml", "axis"},
+    {corpus_dir + "vax1.yaml", "axis"},
+    {corpus_dir + "vax2.yaml", "axis"},
+    {corpus_dir + "vax3.yaml", "axis"},
+    {corpus_dir + "vax4.yaml", "axis"},
+    {corpus_dir + "TRY_full.yaml", "axis"},
+    {corpus_dir + "openloop.yaml", "encoder"},
+    {corpus_dir + "plc1.yaml", "plc"},
+    {fixtures_dir + "yaml/synthetic_axis.yaml", "axis"},
+};
+
+// Runs `function` and adds its duration to the phase `name` of `phases`.
+template<typename Function>
+static void
+measure(std::vector<BenchPhase>& phases, const std::string& name, Function&& function)
+{
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const std::chrono::duration<double, std::micro> duration = std::chrono::steady_clock::now() - start;
+
+    auto it = std::find_if(phases.begin(), phases.end(),
+            [&](const BenchPhase& phase) { return phase.name == name; });
+
+    if (it == phases.end())
+        it = phases.insert(phases.end(), {name, {}});
+
+    it->samples.push_back(duration.count());
+}
+
+static std::string
+get_template(const std::string& schema)
+{
+    return template_dir + "/" + schema + "_main.jinja2";
+}
+
+// Runs all phases of one build of `input` once.
+static void
+run_phases(const BenchInput& input, std::vector<BenchPhase>& phases)
+{
+    static const auto schema_index = ecb::YjSchema::load_schema(filename_schema);
+    const std::string filename_template = get_template(input.schema);
+    json yaml_data;
+
+    measure(phases, "read_yaml", [&]() { ecb::YjYaml().read_yaml(input.filename_yaml, yaml_data); });
+
+    // the checks in the order of YjSchema::validate
+    json cfg_data = yaml_data;
+    ecb::YjSchema OBJ_schema(schema_index, input.schema);
+
+    if (input.schema == "axis")
+    {
+        measure(phases, "schema.add_default_value_from_key",
+            [&]() { OBJ_schema.add_default_value_from_key(cfg_data, "axis.type"); });
+    }
+    else
+        cfg_data["/meta/schemaNumber"_json_pointer] = 0;
+
+    measure(phases, "schema.normalize", [&]() { OBJ_schema.normalize(cfg_data); });
+    measure(phases, "schema.add_schema_default_values",
+        [&]() { OBJ_schema.add_schema_default_values(cfg_data); });
+    measure(phases, "schema.check_and_normalize_datatypes",
+        [&]() { OBJ_schema.check_and_normalize_datatypes(cfg_data); });
+    measure(phases, "schema.renormalize", [&]() { OBJ_schema.normalize(cfg_data); });
+
+    if (input.schema == "axis")
+        cfg_data["/meta/schemaNumber"_json_pointer] = cfg_data["/axis/type"_json_pointer];
+
+    measure(phases, "schema.check_min_max_ranges", [&]() { OBJ_schema.check_min_max_ranges(cfg_data); });
+    measure(phases, "schema.check_schema", [&]() { OBJ_schema.check_schema(input.schema, cfg_data); });
+    measure(phases, "schema.check_for_valid_keys", [&]() { OBJ_schema.check_for_valid_keys(cfg_data); });
+    measure(phases, "schema.remove_undefined_keys", [&]() { OBJ_schema.remove_undefined_keys(cfg_data); });
+
+    // all checks in a single pass, on a fresh copy of the parsed yaml file
+    // and not on the data the checks above already normalized and completed
+    json validated_data = yaml_data;
+    ecb::YjSchema OBJ_validation(schema_index, input.schema);
+    measure(phases, "schema.validate", [&]() { OBJ_validation.validate(validated_data); });
+
+    // a new object has to read, preprocess and parse the template
+    ecb::YjRender OBJ_render;
+    measure(phases, "render.preprocess", [&]() { OBJ_render.preprocess(filename_template, template_dir); });
+    measure(phases, "render.parse_and_render",
+        [&]() { OBJ_render.render(filename_template, template_dir, validated_data); });
+    measure(phases, "render.render",
+        [&]() { OBJ_render.render(filename_template, template_dir, validated_data); });
+
+    // the second build reuses the schema and the template
+    ecb::YjConfiguration OBJ_cfg;
+    measure(phases, "build.cold", [&]()
+    {
+        OBJ_cfg.build(input.filename_yaml, filename_schema, input.schema, filename_template, template_dir);
+    });
+    measure(phases, "build.warm", [&]()
+    {
+        OBJ_cfg.build(input.filename_yaml, filename_schema, input.schema, filename_template, template_dir);
+    });
+}
+
+static json
+get_statistics(const std::string& input, const BenchPhase& phase)
+{
+    std::vector<double> samples = phase.samples;
+    std::sort(samples.begin(), samples.end());
+
+    json ret_val;
+    ret_val["input"] = input;
+    ret_val["phase"] = phase.name;
+    ret_val["iterations"] = samples.size();
+    ret_val["min_us"] = samples.front();
+    ret_val["median_us"] = samples[samples.size() / 2];
+    ret_val["mean_us"] = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    ret_val["max_us"] = samples.back();
+
+    return ret_val;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t iterations = 20;
+    std::string filename_output;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "--iterations")
+            iterations = std::max(1UL, std::stoul(argv[i + 1]));
+        else if (arg == "--output")
+            filename_output = argv[i + 1];
+    }
+
+    // the warnings of the validation are not part of the results
+    std::ostream discarded_log(nullptr);
+    ecb::yj_common::redirect_log(&discarded_log);
+
+    json results;
+    results["ecb"]["version"] = MAKEFILE_BUILD_VERSION;
+    results["ecb"]["build"] = MAKEFILE_BUILD_NUMBER MAKEFILE_BUILD_DIRTY;
+    results["ecb"]["hash"] = MAKEFILE_BUILD_HASH;
+    results["iterations"] = iterations;
+    results["results"] = json::array();
+
+    std::vector<BenchPhase> schema_phases;
+
+    const std::string binary_schema = ecb::YjSchema::load_schema(filename_schema)->to_binary();
+
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        measure(schema_phases, "load_schema", []() { ecb::YjSchema::load_schema(filename_schema); });
+        measure(schema_phases, "load_schema.binary",
+            [&]() { ecb::YjSchemaIndex::from_binary(binary_schema); });
+    }
+
+    for (const auto& phase : schema_phases)
+        results["results"].push_back(get_statistics(filename_schema, phase));
+
+    int ret_val = 0;
+
+    for (const auto& input : inputs)
+    {
+        std::vector<BenchPhase> phases;
+
+        try
+        {
+            for (size_t i = 0; i < iterations; ++i)
+                run_phases(input, phases);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << input.filename_yaml << ": " << e.what() << std::endl;
+            results["errors"].push_back({{"input", input.filename_yaml}, {"error", e.what()}});
+            ret_val = 1;
+            continue;
+        }
+
+        for (const auto& phase : phases)
+            results["results"].push_back(get_statistics(input.filename_yaml, phase));
+    }
+
+    // short summary for humans, the details are in the JSON output
+    for (const auto& result : results["results"])
+    {
+        std::fprintf(stderr, "%-44s %-36s %10.1f us\n", result["input"].get<std::string>().c_str(),
+            result["phase"].get<std::string>().c_str(), result["median_us"].get<double>());
+    }
+
+    if (filename_output.empty())
+        std::cout << results.dump(2) << std::endl;
+    else
+        std::ofstream(filename_output) << results.dump(2) << std::endl;
+
+    return ret_val;
+}
@@ -27,29 +27,75 @@ const std::string help_text = "\nECB - ecmc configuration builder\n"
     "\n"
     "Usage:\n"
     "  ecb [--action build] --yaml YFILE --schema SCHEMA --schemafile SFILE\n"
-    "      --template TFILE --templatedir TDIR [--output OFILE]\n"
+    "      --template TFILE --templatedir TDIR [--output OFILE] [--cachedir CDIR]\n"
+    "      [--profile PFILE] [--fsync yes|no]\n"
     "\n"
-    "  ecb --action readkey --yaml YFILE --key KEY [--output OFILE]\n"
+    "  ecb --action buildmany --manifest MFILE [--jobs N] [--cachedir CDIR]\n"
+    "      [--profile PFILE] [--fsync yes|no]\n"
+    "  ecb --action compileschema --schemafile SFILE --output OFILE\n"
+    "  ecb --action readkey --yaml YFILE --key KEY[,KEY...] [--format FMT]\n"
+    "      [--output OFILE]\n"
     "  ecb --action updatekey --yaml YFILE --key KEY --value VAL [--output OFILE]\n"
+    "  ecb --action updatekeys --yaml YFILE [--values KEY=VAL[,KEY=VAL...]]\n"
+    "      [--patch PFILE] [--output OFILE]\n"
     "\n"
     "Options:\n"
-    "  --action (build|readkey|updatekey)\n"
-    "      Action to run, valid options are 'build' (default), 'readkey' or\n"
-    "      'updatekey'. To build configurations use 'build'. The 'readkey' option\n"
-    "      reads the specified KEY in YFILE. The 'updatekey' option updates the\n"
-    "      value of KEY with VAL if KEY exists in YFILE.\n"
+    "  --action (build|buildmany|compileschema|readkey|updatekey|updatekeys)\n"
+    "      Action to run, valid options are 'build' (default), 'buildmany',\n"
+    "      'compileschema', 'readkey', 'updatekey' or 'updatekeys'. To build\n"
+    "      configurations use 'build'. The 'buildmany' option builds all\n"
+    "      configurations listed in MFILE. The 'compileschema' option compiles\n"
+    "      SFILE into the binary schema OFILE, which can be used as SFILE and\n"
+    "      loads faster. The 'readkey' option reads the specified KEY in YFILE.\n"
+    "      The 'updatekey' option updates the value of KEY with VAL if KEY exists\n"
+    "      in YFILE. The 'updatekeys' option applies all updates of --values and\n"
+    "      --patch to YFILE, which is parsed and written only once.\n"
+    "  --cachedir CDIR\n"
+    "      Directory where preprocessed templates are cached between calls of\n"
+    "      ECB. An entry is used as long as the template and the files it\n"
+    "      includes are unchanged. By default no cache is used.\n"
+    "  --format (epicsEnvSet|env|json)\n"
+    "      Output format of 'readkey': 'epicsEnvSet(NAME, \"VALUE\")' lines\n"
+    "      for iocsh, NAME='VALUE' lines for a shell or a JSON object. NAME is\n"
+    "      the key with '.' replaced by '_', e.g. axis_id. By default only the\n"
+    "      values are printed, one per line.\n"
+    "  --fsync (yes|no)\n"
+    "      Flush output files to the disk before they replace the previous\n"
+    "      file. Default is 'no'.\n"
     "  --help\n"
     "      Show this text.\n"
+    "  --jobs N\n"
+    "      Number of threads used by 'buildmany'. Defaults to one thread per\n"
+    "      CPU core.\n"
     "  --key KEY\n"
     "      Read or update the value of KEY. If the key doesn't exist in YFILE,\n"
-    "      then ECB just quits.\n"
+    "      then ECB just quits. 'readkey' accepts a comma separated list of\n"
+    "      keys, which are read from a single parse of YFILE. A '*' in KEY\n"
+    "      matches any characters, e.g. 'drive.error.*' reads all keys below\n"
+    "      drive.error.\n"
+    "  --manifest MFILE\n"
+    "      Filename of the build manifest, a YAML file that lists the\n"
+    "      configurations to build (see documentation).\n"
     "  --output OFILE\n"
     "      Write the rendered Jinja2 template to OFILE. If this option is not\n"
-    "      specified, the rendered template will be written to stdout.\n"
+    "      specified, the rendered template will be written to stdout. If\n"
+    "      nothing changed since the last build of OFILE, it is not built\n"
+    "      again (see OFILE.digest). OFILE is replaced atomically and keeps\n"
+    "      its modification time if its content is unchanged.\n"
+    "  --patch PFILE\n"
+    "      JSON merge patch (RFC 7396) for 'updatekeys', e.g.\n"
+    "      {\"axis\": {\"id\": 2, \"name\": null}}. Nested objects address nested\n"
+    "      keys, null removes the key. Keys that don't exist in YFILE are not\n"
+    "      added, a warning is printed for each of them.\n"
+    "  --profile PFILE\n"
+    "      Print the wall time of each build phase and operation counters to\n"
+    "      stderr and write them as JSON to PFILE. Use '-' as PFILE to skip\n"
+    "      the JSON file.\n"
     "  --schema SCHEMA\n"
     "      Specifie schema to use, valid options are axis, encoder or plc.\n"
     "  --schemafile SFILE\n"
-    "      Filename of ECB schema file.\n"
+    "      Filename of ECB schema file, either JSON or compiled with\n"
+    "      'compileschema'.\n"
     "  --template TFILE\n"
     "      Filename of Jinja2 template.\n"
     "  --templatedir TDIR\n"
@@ -58,6 +104,13 @@ const std::string help_text = "\nECB - ecmc configuration builder\n"
     "      found in this directory\n"
     "  --value VAL\n"
     "      Update the value of KEY specified with the --key option to VAL.\n"
+    "  --values KEY=VAL[,KEY=VAL...]\n"
+    "      Comma separated list of keys and their values for 'updatekeys'.\n"
+    "      A comma or backslash in a value is escaped with a backslash, e.g.\n"
+    "      name=a\\,b. Values with many special characters are easier to set with\n"
+    "      --patch.\n"
+    "      Keys that don't exist in YFILE are not added, a warning is printed\n"
+    "      for each of them.\n"
     "  --version\n"
     "      Show version.\n"
     "  --yaml YFILE\n"
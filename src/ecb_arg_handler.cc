@@ -33,10 +33,19 @@ const std::unordered_map<std::string, std::vector<std::string>> valid_args =
     {"--templatedir", {""}},
     {"--schema", {"axis", "encoder", "plc"}},
     {"--schemafile", {""}},
-    {"--action", {"build", "readkey", "updatekey"}},
+    {"--action", {"build", "buildmany", "compileschema", "readkey", "updatekey",
+            "updatekeys"}},
+    {"--manifest", {""}},
+    {"--jobs", {""}},
+    {"--cachedir", {""}},
+    {"--profile", {""}},
+    {"--fsync", {"yes", "no"}},
     {"--output", {""}},
     {"--key", {""}},
+    {"--format", {"epicsEnvSet", "env", "json"}},
     {"--value", {""}},
+    {"--values", {""}},
+    {"--patch", {""}},
     {"--version", {""}},
 };
 
@@ -44,10 +53,14 @@ const std::unordered_map<mode, std::vector<std::string>> valid_combinations =
 {
     {mode::YJ_BUILD_CFG_TO_STDOUT, {"--yaml", "--schemafile", "--schema",  "--action", "--template", "--templatedir"}},
     {mode::YJ_BUILD_CFG_TO_FILE, {"--yaml", "--schemafile", "--schema",  "--action", "--template", "--templatedir", "--output"}},
+    {mode::YJ_BUILD_MANY, {"--action", "--manifest"}},
+    {mode::YJ_COMPILE_SCHEMA, {"--action", "--schemafile", "--output"}},
     {mode::YJ_READ_KEY_TO_STDOUT, {"--yaml", "--action", "--key"}},
     {mode::YJ_READ_KEY_TO_FILE, {"--yaml", "--action", "--key", "--output"}},
     {mode::YJ_UPDATE_KEY, {"--yaml", "--action", "--key", "--value", "--output"}},
     {mode::YJ_UPDATE_KEY_TO_STDOUT, {"--yaml", "--action", "--key", "--value"}},
+    {mode::YJ_UPDATE_KEYS, {"--yaml", "--action", "--output"}},
+    {mode::YJ_UPDATE_KEYS_TO_STDOUT, {"--yaml", "--action"}},
     {mode::BUILD_INFO, {"--version"}},
     {mode::HELP, {"--help"}},
 };
@@ -83,8 +96,12 @@ ArgHandler::get_mode(void)
     check_combination(mode::YJ_READ_KEY_TO_FILE, true, "readkey");
     check_combination(mode::YJ_BUILD_CFG_TO_STDOUT, true, "build");
     check_combination(mode::YJ_BUILD_CFG_TO_FILE, true, "build");
+    check_combination(mode::YJ_BUILD_MANY, true, "buildmany");
+    check_combination(mode::YJ_COMPILE_SCHEMA, true, "compileschema");
     check_combination(mode::YJ_UPDATE_KEY_TO_STDOUT, true, "updatekey");
     check_combination(mode::YJ_UPDATE_KEY, true, "updatekey");
+    check_combination(mode::YJ_UPDATE_KEYS_TO_STDOUT, true, "updatekeys");
+    check_combination(mode::YJ_UPDATE_KEYS, true, "updatekeys");
     check_combination(mode::BUILD_INFO, false, "updatekey");
     check_combination(mode::HELP, false, "updatekey");
 
@@ -149,6 +166,70 @@ ArgHandler::get_output_filename(void)
 
 }
 
+std::string
+ArgHandler::get_manifest_filename(void)
+{
+    std::string ret_val = {};
+
+    if (auto it = args_.find("--manifest") ; it != args_.end())
+        ret_val = args_["--manifest"];
+
+    return ret_val;
+}
+
+unsigned int
+ArgHandler::get_jobs(void)
+{
+    unsigned int ret_val = 0;
+
+    if (auto it = args_.find("--jobs") ; it != args_.end())
+    {
+        try
+        {
+            ret_val = std::stoul(it->second);
+        }
+        catch (...)
+        {
+            ret_val = 0;
+        }
+    }
+
+    return ret_val;
+}
+
+std::string
+ArgHandler::get_cache_dir(void)
+{
+    std::string ret_val = {};
+
+    if (auto it = args_.find("--cachedir") ; it != args_.end())
+        ret_val = args_["--cachedir"];
+
+    return ret_val;
+}
+
+std::string
+ArgHandler::get_profile_filename(void)
+{
+    std::string ret_val = {};
+
+    if (auto it = args_.find("--profile") ; it != args_.end())
+        ret_val = args_["--profile"];
+
+    return ret_val;
+}
+
+bool
+ArgHandler::get_fsync(void)
+{
+    bool ret_val = false;
+
+    if (auto it = args_.find("--fsync") ; it != args_.end())
+        ret_val = (it->second == "yes");
+
+    return ret_val;
+}
+
 std::string
 ArgHandler::get_yj_key_value(void)
 {
@@ -160,6 +241,35 @@ ArgHandler::get_yj_key_value(void)
     return ret_val;
 }
 
+std::vector<std::string>
+ArgHandler::get_yj_keys(void)
+{
+    std::vector<std::string> ret_val;
+
+    if (auto it = args_.find("--key") ; it != args_.end())
+    {
+        size_t start = 0;
+
+        for (size_t end; (end = it->second.find(',', start)) != std::string::npos; start = end + 1)
+            ret_val.push_back(it->second.substr(start, end - start));
+
+        ret_val.push_back(it->second.substr(start));
+    }
+
+    return ret_val;
+}
+
+std::string
+ArgHandler::get_format(void)
+{
+    std::string ret_val = {};
+
+    if (auto it = args_.find("--format") ; it != args_.end())
+        ret_val = args_["--format"];
+
+    return ret_val;
+}
+
 std::string
 ArgHandler::get_yj_value(void)
 {
@@ -171,6 +281,28 @@ ArgHandler::get_yj_value(void)
     return ret_val;
 }
 
+std::string
+ArgHandler::get_yj_values(void)
+{
+    std::string ret_val = {};
+
+    if (auto it = args_.find("--values") ; it != args_.end())
+        ret_val = args_["--values"];
+
+    return ret_val;
+}
+
+std::string
+ArgHandler::get_patch_filename(void)
+{
+    std::string ret_val = {};
+
+    if (auto it = args_.find("--patch") ; it != args_.end())
+        ret_val = args_["--patch"];
+
+    return ret_val;
+}
+
 std::string
 ArgHandler::get_yj_schema_filename(void)
 {
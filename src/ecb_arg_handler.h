@@ -22,6 +22,7 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace ecb
 {
@@ -32,10 +33,14 @@ enum class mode
     HELP,
     YJ_BUILD_CFG_TO_FILE,
     YJ_BUILD_CFG_TO_STDOUT,
+    YJ_BUILD_MANY,
+    YJ_COMPILE_SCHEMA,
     YJ_READ_KEY_TO_FILE,
     YJ_READ_KEY_TO_STDOUT,
     YJ_UPDATE_KEY,
     YJ_UPDATE_KEY_TO_STDOUT,
+    YJ_UPDATE_KEYS,
+    YJ_UPDATE_KEYS_TO_STDOUT,
 };
 
 
@@ -77,12 +82,57 @@ public:
     std::string get_yj_template_filename(void);
 
 
+    // Returns the filename of the build manifest, set by the command line
+    // argument `--manifest`. If `--manifest` is not provided, this function
+    // returns an empty string.
+    std::string get_manifest_filename(void);
+
+
+    // Returns the number of threads for the `buildmany` action, set by the
+    // command line argument `--jobs`. If `--jobs` is not provided or is not
+    // a number, this function returns 0, which means one thread per CPU
+    // core.
+    unsigned int get_jobs(void);
+
+
+    // Returns the directory of the template cache, set by the command line
+    // argument `--cachedir`. If `--cachedir` is not provided, this function
+    // returns an empty string, which disables the cache.
+    std::string get_cache_dir(void);
+
+
+    // Returns the filename for the profile of the run, set by the command
+    // line argument `--profile`. "-" means the profile is only printed to
+    // stderr. If `--profile` is not provided, this function returns an
+    // empty string, which disables profiling.
+    std::string get_profile_filename(void);
+
+
+    // Returns true if output files shall be flushed to the disk before they
+    // replace the previous file, set by the command line argument `--fsync`
+    // with the value "yes". The default is false.
+    bool get_fsync(void);
+
+
     // Returns the name of the key specified by the command line argument
     // `--key`. If `--key` is not provided, this function returns an empty
     // string.
     std::string get_yj_key_value(void);
 
 
+    // Returns the keys specified by the command line argument `--key`, which
+    // is a comma separated list of keys or patterns, e.g.
+    // "axis.id,drive.error.*". If `--key` is not provided, this function
+    // returns an empty list.
+    std::vector<std::string> get_yj_keys(void);
+
+
+    // Returns the output format of the `readkey` action, set by the command
+    // line argument `--format`. If `--format` is not provided, this function
+    // returns an empty string, which means only the values are printed.
+    std::string get_format(void);
+
+
     // Returns the schema specified by the command line argument `--schema`.
     // This is the schema to be used, e.g. "axis" or "plc". If `--schema` is
     // not provided, this function returns an empty string.
@@ -105,6 +155,18 @@ public:
     // If `--value` is not provided, this function returns an empty string.
     std::string get_yj_value(void);
 
+
+    // Returns the `key=value` pairs for the `updatekeys` action, set by the
+    // command line argument `--values`, e.g. "axis.id=2,axis.name=x". If
+    // `--values` is not provided, this function returns an empty string.
+    std::string get_yj_values(void);
+
+
+    // Returns the filename of the JSON merge patch for the `updatekeys`
+    // action, set by the command line argument `--patch`. If `--patch` is
+    // not provided, this function returns an empty string.
+    std::string get_patch_filename(void);
+
 private:
     std::unordered_map<std::string, std::string> args_;
 
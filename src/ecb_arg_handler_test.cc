@@ -55,6 +55,26 @@ TEST_F(ArgHandlerFixture, readKey)
     EXPECT_TRUE(dut1.get_mode() == mode::YJ_READ_KEY_TO_FILE);
 }
 
+TEST_F(ArgHandlerFixture, readKeys)
+{
+    dut1.set_argument("--yaml", "filea.yaml");
+    dut1.set_argument("--action", "readkey");
+    EXPECT_TRUE(dut1.get_yj_keys().empty());
+    EXPECT_TRUE(dut1.get_format() == "");
+
+    dut1.set_argument("--key", "axis.id,epics.name,drive.error.*");
+    EXPECT_TRUE(dut1.get_yj_keys() == std::vector<std::string>({"axis.id", "epics.name",
+            "drive.error.*"}));
+    EXPECT_TRUE(dut1.get_mode() == mode::YJ_READ_KEY_TO_STDOUT);
+
+    EXPECT_TRUE(dut1.set_argument("--format", "epicsEnvSet"));
+    EXPECT_TRUE(dut1.set_argument("--format", "env"));
+    EXPECT_TRUE(dut1.set_argument("--format", "json"));
+    EXPECT_FALSE(dut1.set_argument("--format", "xml"));
+    EXPECT_TRUE(dut1.get_format() == "json");
+    EXPECT_TRUE(dut1.get_mode() == mode::YJ_READ_KEY_TO_STDOUT);
+}
+
 TEST_F(ArgHandlerFixture, updateKey_to_file)
 {
     dut1.set_argument("--yaml", "filea.yaml");
@@ -107,12 +127,80 @@ TEST_F(ArgHandlerFixture, updateKey_to_stdout)
     EXPECT_TRUE(dut1.get_mode() == mode::YJ_UPDATE_KEY_TO_STDOUT);
 }
 
+TEST_F(ArgHandlerFixture, updateKeys)
+{
+    dut1.set_argument("--yaml", "filea.yaml");
+    dut1.set_argument("--action", "updatekeys");
+    EXPECT_TRUE(dut1.get_mode() == mode::YJ_UPDATE_KEYS_TO_STDOUT);
+    EXPECT_TRUE(dut1.get_yj_values() == "");
+    EXPECT_TRUE(dut1.get_patch_filename() == "");
+
+    dut1.set_argument("--values", "a=1,b.c=x");
+    dut1.set_argument("--patch", "patch.json");
+    EXPECT_TRUE(dut1.get_yj_values() == "a=1,b.c=x");
+    EXPECT_TRUE(dut1.get_patch_filename() == "patch.json");
+    EXPECT_TRUE(dut1.get_mode() == mode::YJ_UPDATE_KEYS_TO_STDOUT);
+
+    dut1.set_argument("--output", "fileb.yaml");
+    EXPECT_TRUE(dut1.get_mode() == mode::YJ_UPDATE_KEYS);
+}
+
+TEST_F(ArgHandlerFixture, buildMany)
+{
+    dut1.set_argument("--action", "buildmany");
+    EXPECT_TRUE(dut1.get_mode() == mode::INVALID);
+
+    dut1.set_argument("--manifest", "manifest.yaml");
+    EXPECT_TRUE(dut1.get_manifest_filename() == "manifest.yaml");
+    EXPECT_TRUE(dut1.get_mode() == mode::YJ_BUILD_MANY);
+
+    dut1.set_argument("--action", "build");
+    EXPECT_TRUE(dut1.get_mode() == mode::INVALID);
+}
+
+TEST_F(ArgHandlerFixture, compileSchema)
+{
+    dut1.set_argument("--action", "compileschema");
+    dut1.set_argument("--schemafile", "schema.json");
+    EXPECT_TRUE(dut1.get_mode() == mode::INVALID);
+
+    dut1.set_argument("--output", "schema.bin");
+    EXPECT_TRUE(dut1.get_mode() == mode::YJ_COMPILE_SCHEMA);
+}
+
+TEST_F(ArgHandlerFixture, jobs)
+{
+    EXPECT_TRUE(dut1.get_jobs() == 0);
+
+    dut1.set_argument("--action", "buildmany");
+    dut1.set_argument("--manifest", "manifest.yaml");
+    dut1.set_argument("--jobs", "8");
+    EXPECT_TRUE(dut1.get_jobs() == 8);
+    EXPECT_TRUE(dut1.get_mode() == mode::YJ_BUILD_MANY);
+
+    dut1.set_argument("--jobs", "many");
+    EXPECT_TRUE(dut1.get_jobs() == 0);
+}
+
+TEST_F(ArgHandlerFixture, fsync)
+{
+    EXPECT_FALSE(dut1.get_fsync());
+
+    EXPECT_TRUE(dut1.set_argument("--fsync", "yes"));
+    EXPECT_TRUE(dut1.get_fsync());
+
+    EXPECT_TRUE(dut1.set_argument("--fsync", "no"));
+    EXPECT_FALSE(dut1.get_fsync());
+    EXPECT_FALSE(dut1.set_argument("--fsync", "always"));
+}
+
 TEST_F(ArgHandlerFixture, set_argument_true)
 {
     EXPECT_TRUE(dut1.set_argument("--yaml", "filea.yaml"));
     EXPECT_TRUE(dut1.set_argument("--help", "filea.yaml"));
     EXPECT_TRUE(dut1.set_argument("--output", "filea.yaml"));
     EXPECT_TRUE(dut1.set_argument("--action", "build"));
+    EXPECT_TRUE(dut1.set_argument("--action", "buildmany"));
     EXPECT_TRUE(dut1.set_argument("--action", "readkey"));
     EXPECT_TRUE(dut1.set_argument("--action", "updatekey"));
     EXPECT_TRUE(dut1.set_argument("--key", "updatkey"));
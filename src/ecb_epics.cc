@@ -17,39 +17,56 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <epicsExport.h>
+#include <initHooks.h>
 #include <iocsh.h>
 #include <string.h>
+#include <vector>
 
 #include "ecb.h"
+#include "ecb_session.h"
 
-#define MAX_ECB_ARGUMENT_NO 15
 #define MAX_ECB_ARGUMENT_LENGTH 350
 
+// Schema files and templates stay loaded between `ecb` calls while the
+// session is open. The session is closed at iocInit at the latest.
+static ecb::EcbSession session;
+
 static const iocshArg ecbArgs = {"ecb args", iocshArgArgv};
 static const iocshArg *ecbArgsArray[] = { &ecbArgs };
 static const iocshFuncDef ecbDef = { "ecb", 1, ecbArgsArray };
+static const iocshFuncDef ecbSessionOpenDef = { "ecbSessionOpen", 0, NULL };
+static const iocshFuncDef ecbSessionCloseDef = { "ecbSessionClose", 0, NULL };
 
 static void 
 ecbFunc(const iocshArgBuf *args) {
 
-    int nargs = 0;
-    for (int i=0 ; i < MAX_ECB_ARGUMENT_NO  ; ++i) {
-        if (args[0].aval.av[i] == NULL)
-            break;
-        else
-            nargs = nargs + 1;
-    }
+    // all arguments are passed on, av[0] is the command name
+    std::vector<char*> ptr_argv(args[0].aval.av, args[0].aval.av + args[0].aval.ac);
+
+    session.run(static_cast<int>(ptr_argv.size()), ptr_argv.data());
+}
+
+static void
+ecbSessionOpenFunc(const iocshArgBuf *args) {
+    session.open();
+}
 
-    char *ptr_argv[MAX_ECB_ARGUMENT_NO];
-    for (int i = 0 ; i < nargs ; ++i) {
-        ptr_argv[i] = args[0].aval.av[i];
-    }
+static void
+ecbSessionCloseFunc(const iocshArgBuf *args) {
+    session.close();
+}
 
-    ecb_run(nargs, ptr_argv);
+static void
+ecbInitHook(initHookState state) {
+    if (state == initHookAtIocBuild)
+        session.close();
 }
 
 static void 
 ecbRegister(void) {
     iocshRegister (&ecbDef, ecbFunc);
+    iocshRegister (&ecbSessionOpenDef, ecbSessionOpenFunc);
+    iocshRegister (&ecbSessionCloseDef, ecbSessionCloseFunc);
+    initHookRegister(ecbInitHook);
 }
 epicsExportRegistrar(ecbRegister);
@@ -0,0 +1,262 @@
+//
+// ECB - library interface
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <inja.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ecb_lib.h"
+#include "yj_cfg.h"
+#include "yj_common.h"
+#include "yj_yaml.h"
+
+struct ecb_context
+{
+    ecb::YjConfiguration configuration;
+    std::string message;
+    std::string log;
+    ecb_error error = {ECB_OK, "", ""};
+};
+
+// returns a copy of `value`, which the caller releases with `ecb_free`
+static char*
+copy_to_buffer(const std::string& value)
+{
+    char* ret_val = static_cast<char*>(std::malloc(value.size() + 1));
+
+    if (ret_val == nullptr)
+        throw std::bad_alloc();
+
+    std::memcpy(ret_val, value.c_str(), value.size() + 1);
+    return ret_val;
+}
+
+// stores the result of a call in `context`
+static ecb_status
+set_error(ecb_context* context, ecb_status status, const std::string& message,
+    const std::string& log = "")
+{
+    context->message = message;
+    context->log = log;
+    context->error.status = status;
+    context->error.message = context->message.c_str();
+    context->error.log = context->log.c_str();
+    return status;
+}
+
+// Runs `function` with the log output collected in `context` and converts
+// exceptions into a status. Errors of the YAML parser are thrown only in the
+// calling thread, the rapidyaml callbacks of the process are not changed.
+template <typename Function>
+static ecb_status
+call(ecb_context* context, Function function)
+{
+    std::ostringstream log;
+    ecb_status status = ECB_OK;
+    std::string message;
+
+    ecb::yj_common::redirect_log(&log);
+    ecb::YjYaml::throw_parse_errors(true);
+
+    try
+    {
+        status = function(message);
+    }
+    catch (const ecb::YjYamlError& e)
+    {
+        status = ECB_ERROR_YAML;
+        message = e.what();
+    }
+    catch (const inja::InjaError& e)
+    {
+        status = ECB_ERROR_TEMPLATE;
+        message = e.what();
+    }
+    catch (const std::bad_alloc& e)
+    {
+        status = ECB_ERROR_INTERNAL;
+        message = e.what();
+    }
+    catch (const std::exception& e)
+    {
+        status = ECB_ERROR_CONFIGURATION;
+        message = e.what();
+    }
+    catch (...)
+    {
+        status = ECB_ERROR_INTERNAL;
+        message = "unknown error";
+    }
+
+    ecb::YjYaml::throw_parse_errors(false);
+    ecb::yj_common::redirect_log(nullptr);
+    return set_error(context, status, message, log.str());
+}
+
+ecb_context*
+ecb_context_create(void)
+{
+    return new (std::nothrow) ecb_context();
+}
+
+void
+ecb_context_destroy(ecb_context* context)
+{
+    delete context;
+}
+
+ecb_status
+ecb_set_cache_dir(ecb_context* context, const char* cache_dir)
+{
+    if (context == nullptr)
+        return ECB_ERROR_ARGUMENT;
+
+    return call(context, [&](std::string&)
+    {
+        context->configuration.set_cache_dir((cache_dir == nullptr) ? "" : cache_dir);
+        return ECB_OK;
+    });
+}
+
+const ecb_error*
+ecb_last_error(const ecb_context* context)
+{
+    return (context == nullptr) ? nullptr : &context->error;
+}
+
+ecb_status
+ecb_build_to_buffer(
+    ecb_context* context,
+    const char* filename_yaml,
+    const char* filename_schema,
+    const char* selected_schema,
+    const char* filename_template,
+    const char* template_dir,
+    char** output,
+    size_t* output_size)
+{
+    if ((context == nullptr) || (output == nullptr))
+        return ECB_ERROR_ARGUMENT;
+
+    *output = nullptr;
+
+    if ((filename_yaml == nullptr) || (filename_schema == nullptr) ||
+        (selected_schema == nullptr) || (filename_template == nullptr) || (template_dir == nullptr))
+        return set_error(context, ECB_ERROR_ARGUMENT, "missing argument");
+
+    return call(context, [&](std::string & message)
+    {
+        std::ostringstream configuration;
+
+        if (!context->configuration.build(filename_yaml, filename_schema, selected_schema,
+                filename_template, template_dir, configuration))
+        {
+            message = "rendering failed: " + std::string(filename_template);
+            return ECB_ERROR_TEMPLATE;
+        }
+
+        const std::string result = configuration.str();
+        *output = copy_to_buffer(result);
+
+        if (output_size != nullptr)
+            *output_size = result.size();
+
+        return ECB_OK;
+    });
+}
+
+ecb_status
+ecb_build_to_file(
+    ecb_context* context,
+    const char* filename_yaml,
+    const char* filename_schema,
+    const char* selected_schema,
+    const char* filename_template,
+    const char* template_dir,
+    const char* filename_output)
+{
+    if (context == nullptr)
+        return ECB_ERROR_ARGUMENT;
+
+    if ((filename_yaml == nullptr) || (filename_schema == nullptr) ||
+        (selected_schema == nullptr) || (filename_template == nullptr) ||
+        (template_dir == nullptr) || (filename_output == nullptr))
+        return set_error(context, ECB_ERROR_ARGUMENT, "missing argument");
+
+    return call(context, [&](std::string&)
+    {
+        context->configuration.build_to_file({filename_yaml, filename_schema, selected_schema,
+                filename_template, template_dir, filename_output});
+        return ECB_OK;
+    });
+}
+
+ecb_status
+ecb_read_keys(
+    ecb_context* context,
+    const char* filename_yaml,
+    const char* const* keys,
+    size_t key_count,
+    char** values)
+{
+    if ((context == nullptr) || (values == nullptr))
+        return ECB_ERROR_ARGUMENT;
+
+    for (size_t i = 0; i < key_count; ++i)
+        values[i] = nullptr;
+
+    if ((filename_yaml == nullptr) || ((keys == nullptr) && (key_count > 0)))
+        return set_error(context, ECB_ERROR_ARGUMENT, "missing argument");
+
+    for (size_t i = 0; i < key_count; ++i)
+        if ((keys[i] == nullptr) || (keys[i][0] == '\0'))
+            return set_error(context, ECB_ERROR_ARGUMENT, "empty key");
+
+    ecb_status ret_val = call(context, [&](std::string&)
+    {
+        const auto result = context->configuration.read_keys(filename_yaml,
+                std::vector<std::string>(keys, keys + key_count));
+
+        for (size_t i = 0; i < key_count; ++i)
+            values[i] = copy_to_buffer(result[i]);
+
+        return ECB_OK;
+    });
+
+    // no partial results
+    if (ret_val != ECB_OK)
+        for (size_t i = 0; i < key_count; ++i)
+        {
+            std::free(values[i]);
+            values[i] = nullptr;
+        }
+
+    return ret_val;
+}
+
+void
+ecb_free(void* buffer)
+{
+    std::free(buffer);
+}
@@ -0,0 +1,120 @@
+//
+// ECB - library interface
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _ECB_LIB_H_
+#define _ECB_LIB_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Builds configurations without starting `ecb`. A context keeps the schema
+// files and templates it has loaded, so building many configurations from
+// the same files parses them only once; edited files are loaded again. The
+// functions never print; they return a status, and the message and the log
+// output of the last call are available with `ecb_last_error`. A context
+// must not be used by several threads at the same time, use one context per
+// thread instead.
+typedef struct ecb_context ecb_context;
+
+typedef enum ecb_status
+{
+    ECB_OK = 0,
+    // an argument is NULL or invalid
+    ECB_ERROR_ARGUMENT,
+    // the YAML file could not be parsed
+    ECB_ERROR_YAML,
+    // a file is missing or the configuration does not match the schema
+    ECB_ERROR_CONFIGURATION,
+    // the template could not be parsed or rendered
+    ECB_ERROR_TEMPLATE,
+    // any other error, e.g. out of memory
+    ECB_ERROR_INTERNAL
+} ecb_status;
+
+// Result of the last call of a context. The strings are owned by the
+// context and valid until its next call.
+typedef struct ecb_error
+{
+    ecb_status status;
+    // error message, empty if `status` is ECB_OK
+    const char* message;
+    // log output of the call, e.g. warnings or the failing template
+    const char* log;
+} ecb_error;
+
+// Returns a new context, or NULL if it could not be created.
+ecb_context* ecb_context_create(void);
+
+// Releases `context` and everything it has loaded.
+void ecb_context_destroy(ecb_context* context);
+
+// Stores preprocessed templates in the directory `cache_dir`, NULL or an
+// empty string disables the cache (see `--cachedir`).
+ecb_status ecb_set_cache_dir(ecb_context* context, const char* cache_dir);
+
+// Returns the result of the last call with `context`.
+const ecb_error* ecb_last_error(const ecb_context* context);
+
+// Builds the configuration like `ecb --action build` and stores it in
+// `*output`, a null-terminated buffer which must be released with
+// `ecb_free`. `output_size` can be NULL, otherwise it receives the length of
+// the configuration. `*output` is NULL if the build failed.
+ecb_status ecb_build_to_buffer(
+    ecb_context* context,
+    const char* filename_yaml,
+    const char* filename_schema,
+    const char* selected_schema,
+    const char* filename_template,
+    const char* template_dir,
+    char** output,
+    size_t* output_size);
+
+// Builds the configuration like `ecb --action build --output`, including
+// the digest that skips unchanged configurations.
+ecb_status ecb_build_to_file(
+    ecb_context* context,
+    const char* filename_yaml,
+    const char* filename_schema,
+    const char* selected_schema,
+    const char* filename_template,
+    const char* template_dir,
+    const char* filename_output);
+
+// Reads the values of the `key_count` keys `keys` from the YAML file, which
+// is parsed only once. `values` must provide `key_count` elements, each
+// receives a null-terminated string which must be released with `ecb_free`.
+// Undefined keys have an empty string as value. The elements are NULL if
+// the call failed.
+ecb_status ecb_read_keys(
+    ecb_context* context,
+    const char* filename_yaml,
+    const char* const* keys,
+    size_t key_count,
+    char** values);
+
+// Releases a buffer returned by the functions above.
+void ecb_free(void* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _ECB_LIB_H_
@@ -0,0 +1,163 @@
+//
+// ECB - tests for ecb_lib module
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <rapidyaml.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "ecb_lib.h"
+
+class EcbLibFixture : public testing::Test
+{
+protected:
+
+    EcbLibFixture()
+    {
+        dir = std::filesystem::temp_directory_path() / "ecb_lib_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+
+        std::ofstream(dir / "schema.json") << R"(
+            {
+              "grandSchema": {"axis": {"axis.type=1": {"required": "axisSchema metaSchema"}}},
+              "metaSchema": {"identifier": "meta", "allowAnySubkey": true},
+              "axisSchema": {
+                "identifier": "axis",
+                "schema": {
+                  "axis.type": {"type": "integer", "default": 1},
+                  "axis.id": {"type": "integer", "required": true},
+                  "axis.name": {"type": "string"}
+                }
+              }
+            })";
+        std::ofstream(dir / "axis.jinja2") << "axis {{ axis.id }}";
+        std::ofstream(dir / "broken.jinja2") << "axis {{ axis.id ";
+        std::ofstream(dir / "axis1.yaml") << "axis:\n  id: 1\n  name: x\n";
+        std::ofstream(dir / "noid.yaml") << "axis:\n  name: x\n";
+        std::ofstream(dir / "invalid.yaml") << "axis:\n  id: [1\n";
+
+        dut1 = ecb_context_create();
+    }
+
+    ~EcbLibFixture()
+    {
+        ecb_context_destroy(dut1);
+        std::filesystem::remove_all(dir);
+    }
+
+    // Builds `yaml` with `template_file` and returns the status, the
+    // configuration is stored in `output`.
+    ecb_status build(const std::string& yaml, const std::string& template_file = "axis.jinja2")
+    {
+        char* buffer = nullptr;
+        size_t size = 0;
+
+        output.clear();
+        ecb_status ret_val = ecb_build_to_buffer(dut1, (dir / yaml).c_str(),
+                (dir / "schema.json").c_str(), "axis", (dir / template_file).c_str(),
+                dir.c_str(), &buffer, &size);
+
+        if (buffer != nullptr)
+            output.assign(buffer, size);
+
+        ecb_free(buffer);
+        return ret_val;
+    }
+
+    std::filesystem::path dir;
+    std::string output;
+    ecb_context* dut1;
+};
+
+TEST_F(EcbLibFixture, buildToBuffer)
+{
+    ASSERT_TRUE(dut1 != nullptr);
+    EXPECT_TRUE(build("axis1.yaml") == ECB_OK);
+    EXPECT_TRUE(output == "axis 1");
+    EXPECT_TRUE(ecb_last_error(dut1)->status == ECB_OK);
+    EXPECT_TRUE(std::string(ecb_last_error(dut1)->message).empty());
+
+    // the context is reusable after a failure
+    EXPECT_TRUE(build("noid.yaml") == ECB_ERROR_CONFIGURATION);
+    EXPECT_TRUE(output.empty());
+    EXPECT_TRUE(std::string(ecb_last_error(dut1)->message).find("axis.id") != std::string::npos);
+    EXPECT_TRUE(build("axis1.yaml") == ECB_OK);
+    EXPECT_TRUE(output == "axis 1");
+}
+
+TEST_F(EcbLibFixture, buildToFile)
+{
+    const std::string filename_output = (dir / "out.cmd").string();
+
+    EXPECT_TRUE(ecb_build_to_file(dut1, (dir / "axis1.yaml").c_str(),
+            (dir / "schema.json").c_str(), "axis", (dir / "axis.jinja2").c_str(), dir.c_str(),
+            filename_output.c_str()) == ECB_OK);
+
+    std::ifstream file(filename_output);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_TRUE(content == "axis 1");
+
+    EXPECT_TRUE(ecb_build_to_file(dut1, (dir / "axis1.yaml").c_str(), nullptr, "axis",
+            (dir / "axis.jinja2").c_str(), dir.c_str(), filename_output.c_str()) ==
+        ECB_ERROR_ARGUMENT);
+}
+
+TEST_F(EcbLibFixture, errors)
+{
+    // the errors are returned, nothing is printed or aborted
+    auto error_callback = ryml::get_callbacks().m_error;
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(build("invalid.yaml") == ECB_ERROR_YAML);
+    EXPECT_TRUE(build("axis1.yaml", "broken.jinja2") == ECB_ERROR_TEMPLATE);
+    EXPECT_FALSE(std::string(ecb_last_error(dut1)->log).empty());
+    EXPECT_TRUE(build("missing.yaml") == ECB_ERROR_CONFIGURATION);
+    EXPECT_TRUE(testing::internal::GetCapturedStdout().empty());
+
+    // the rapidyaml callbacks of the process are not changed
+    EXPECT_TRUE(ryml::get_callbacks().m_error == error_callback);
+
+    char* buffer = nullptr;
+    EXPECT_TRUE(ecb_build_to_buffer(nullptr, "", "", "", "", "", &buffer, nullptr) ==
+        ECB_ERROR_ARGUMENT);
+    EXPECT_TRUE(ecb_build_to_buffer(dut1, nullptr, "", "", "", "", &buffer, nullptr) ==
+        ECB_ERROR_ARGUMENT);
+    EXPECT_TRUE(buffer == nullptr);
+    EXPECT_TRUE(ecb_last_error(dut1)->status == ECB_ERROR_ARGUMENT);
+}
+
+TEST_F(EcbLibFixture, readKeys)
+{
+    const char* keys[] = {"axis.id", "axis.name", "axis.unknown"};
+    char* values[3];
+
+    EXPECT_TRUE(ecb_read_keys(dut1, (dir / "axis1.yaml").c_str(), keys, 3, values) == ECB_OK);
+    EXPECT_TRUE(std::string(values[0]) == "1");
+    EXPECT_TRUE(std::string(values[1]) == "x");
+    EXPECT_TRUE(std::string(values[2]).empty());
+
+    for (auto* value : values)
+        ecb_free(value);
+
+    EXPECT_TRUE(ecb_read_keys(dut1, (dir / "missing.yaml").c_str(), keys, 3, values) ==
+        ECB_ERROR_CONFIGURATION);
+    EXPECT_TRUE(values[0] == nullptr);
+}
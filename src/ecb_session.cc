@@ -0,0 +1,288 @@
+//
+// ECB - session that keeps loaded files between runs
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "ecb.h"
+#include "ecb_arg_handler.h"
+#include "ecb_session.h"
+#include "yj_common.h"
+#include "yj_profile.h"
+
+// Prints `profile` to stderr and writes it as JSON to `filename_profile`,
+// unless the filename is "-".
+static void
+write_profile(const ecb::YjProfile& profile, const std::string& filename_profile)
+{
+    std::cerr << profile.to_text();
+
+    if (filename_profile != "-")
+    {
+        std::string filename = filename_profile;
+        std::string data = profile.to_json().dump(2);
+        ecb::yj_common::write_file(filename, data);
+    }
+}
+
+// Applies the updates of `--values` and `--patch` to the YAML file of the
+// `updatekeys` action and returns the modified YAML content.
+static std::string
+update_keys(ecb::ArgHandler& OBJ_argparser, ecb::YjConfiguration& OBJ_yj_cfg)
+{
+    auto updates = OBJ_yj_cfg.read_key_updates(OBJ_argparser.get_yj_values());
+
+    if (const std::string filename_patch = OBJ_argparser.get_patch_filename();
+        !filename_patch.empty())
+    {
+        auto patch = OBJ_yj_cfg.read_patch(filename_patch);
+        updates.insert(updates.end(), patch.begin(), patch.end());
+    }
+
+    if (updates.empty())
+        throw std::runtime_error("updatekeys: --values or --patch required");
+
+    return OBJ_yj_cfg.update_keys(OBJ_argparser.get_yj_yaml_filename(), updates);
+}
+
+void
+ecb::EcbSession::open()
+{
+    if (yj_cfg_ == nullptr)
+        yj_cfg_ = std::make_unique<YjConfiguration>();
+}
+
+void
+ecb::EcbSession::close()
+{
+    yj_cfg_.reset();
+}
+
+bool
+ecb::EcbSession::is_open() const
+{
+    return (yj_cfg_ != nullptr);
+}
+
+ecb::YjTemplateCacheStats
+ecb::EcbSession::get_template_cache_stats()
+{
+    if (yj_cfg_ == nullptr)
+        return YjTemplateCacheStats();
+
+    return yj_cfg_->get_template_cache_stats();
+}
+
+void
+ecb::EcbSession::run(int argc, char* argv[])
+{
+    auto OBJ_argparser = ecb::ArgHandler();
+
+    OBJ_argparser.set_argument("--action", "build");
+
+    if (argc > 2)
+    {
+        for (int i = 1 ; i < argc ; i = i + 2)
+        {
+            if (i + 1 < argc)
+                OBJ_argparser.set_argument(argv[i], argv[i + 1]);
+        }
+    }
+    else if (argc == 2)
+        OBJ_argparser.set_argument(argv[1], "");
+
+    // without an open session everything is loaded again
+    std::unique_ptr<YjConfiguration> temporary_cfg;
+
+    if (yj_cfg_ == nullptr)
+        temporary_cfg = std::make_unique<YjConfiguration>();
+
+    auto& OBJ_yj_cfg = (yj_cfg_ != nullptr) ? *yj_cfg_ : *temporary_cfg;
+    OBJ_yj_cfg.set_cache_dir(OBJ_argparser.get_cache_dir());
+    OBJ_yj_cfg.set_fsync(OBJ_argparser.get_fsync());
+
+    // phases and counters of this run, see `--profile`
+    const std::string filename_profile = OBJ_argparser.get_profile_filename();
+    YjProfile profile;
+    const auto start = std::chrono::steady_clock::now();
+
+    // lambda, stops recording and writes the profile
+    auto finish_profile = [&]()
+    {
+        if (filename_profile.empty())
+            return;
+
+        const std::chrono::duration<double, std::micro> duration =
+            std::chrono::steady_clock::now() - start;
+
+        yj_profile::record(nullptr);
+        profile.set_wall_time(duration.count());
+        write_profile(profile, filename_profile);
+    };
+
+    if (!filename_profile.empty())
+        yj_profile::record(&profile);
+
+    // Neither `ecb` nor the IOC shell catch exceptions. Without a handler
+    // the program may terminate without unwinding the stack, which would
+    // leave the temporary files of `YjOutputFile` behind.
+    try
+    {
+        run_mode(OBJ_argparser, OBJ_yj_cfg);
+    }
+    catch (...)
+    {
+        finish_profile();
+        throw;
+    }
+
+    finish_profile();
+}
+
+void
+ecb::EcbSession::run_mode(ArgHandler& OBJ_argparser, YjConfiguration& OBJ_yj_cfg)
+{
+    switch (OBJ_argparser.get_mode())
+    {
+        case ecb::mode::YJ_READ_KEY_TO_STDOUT:
+        {
+            std::string output = OBJ_yj_cfg.read_keys_formatted(
+                    OBJ_argparser.get_yj_yaml_filename(), OBJ_argparser.get_yj_keys(),
+                    OBJ_argparser.get_format());
+            std::cout << output << std::endl;
+            break;
+        }
+
+        case ecb::mode::YJ_READ_KEY_TO_FILE:
+        {
+            std::string output = OBJ_yj_cfg.read_keys_formatted(
+                    OBJ_argparser.get_yj_yaml_filename(), OBJ_argparser.get_yj_keys(),
+                    OBJ_argparser.get_format());
+
+            std::string filename = OBJ_argparser.get_output_filename();
+            ecb::yj_common::write_file(filename, output, OBJ_argparser.get_fsync());
+
+            break;
+        }
+
+        case ecb::mode::YJ_UPDATE_KEY:
+        {
+            std::string output = OBJ_yj_cfg.update_key(
+                    OBJ_argparser.get_yj_yaml_filename(),
+                    OBJ_argparser.get_yj_key_value(),
+                    OBJ_argparser.get_yj_value());
+
+            if (output != "")
+            {
+                std::string filename = OBJ_argparser.get_output_filename();
+                ecb::yj_common::write_file(filename, output, OBJ_argparser.get_fsync());
+            }
+
+            break;
+        }
+
+        case ecb::mode::YJ_UPDATE_KEY_TO_STDOUT:
+        {
+            std::string output = OBJ_yj_cfg.update_key(
+                    OBJ_argparser.get_yj_yaml_filename(),
+                    OBJ_argparser.get_yj_key_value(),
+                    OBJ_argparser.get_yj_value());
+
+            std::cout << output << std::endl;
+            break;
+        }
+
+        case ecb::mode::YJ_UPDATE_KEYS:
+        {
+            std::string output = update_keys(OBJ_argparser, OBJ_yj_cfg);
+            std::string filename = OBJ_argparser.get_output_filename();
+            ecb::yj_common::write_file(filename, output, OBJ_argparser.get_fsync());
+            break;
+        }
+
+        case ecb::mode::YJ_UPDATE_KEYS_TO_STDOUT:
+        {
+            std::cout << update_keys(OBJ_argparser, OBJ_yj_cfg) << std::endl;
+            break;
+        }
+
+        case ecb::mode::YJ_BUILD_CFG_TO_STDOUT:
+        {
+            OBJ_yj_cfg.build(
+                    OBJ_argparser.get_yj_yaml_filename(),
+                    OBJ_argparser.get_yj_schema_filename(),
+                    OBJ_argparser.get_yj_schema(),
+                    OBJ_argparser.get_yj_template_filename(),
+                    OBJ_argparser.get_yj_template_dir(),
+                    std::cout);
+            std::cout << std::endl;
+            break;
+
+        }
+
+        case ecb::mode::YJ_BUILD_CFG_TO_FILE:
+        {
+            ecb::YjBuildEntry entry;
+            entry.filename_yaml = OBJ_argparser.get_yj_yaml_filename();
+            entry.filename_schema = OBJ_argparser.get_yj_schema_filename();
+            entry.selected_schema = OBJ_argparser.get_yj_schema();
+            entry.filename_template = OBJ_argparser.get_yj_template_filename();
+            entry.template_dir = OBJ_argparser.get_yj_template_dir();
+            entry.filename_output = OBJ_argparser.get_output_filename();
+
+            OBJ_yj_cfg.build_to_file(entry);
+            break;
+        }
+
+        case ecb::mode::YJ_BUILD_MANY:
+        {
+            const auto entries = OBJ_yj_cfg.read_manifest(OBJ_argparser.get_manifest_filename());
+            OBJ_yj_cfg.build_many(entries, OBJ_argparser.get_jobs());
+            break;
+        }
+
+        case ecb::mode::YJ_COMPILE_SCHEMA:
+        {
+            std::string output = OBJ_yj_cfg.compile_schema(OBJ_argparser.get_yj_schema_filename());
+            std::string filename = OBJ_argparser.get_output_filename();
+            ecb::yj_common::write_file(filename, output, OBJ_argparser.get_fsync());
+            break;
+        }
+
+        case ecb::mode::BUILD_INFO:
+        {
+            std::cout << "ECB - ecmc configuration builder" << std::endl
+                << "--------------------------------" << std::endl
+                << "version: " << MAKEFILE_BUILD_VERSION << std::endl
+                << "build  : #" << MAKEFILE_BUILD_NUMBER << MAKEFILE_BUILD_DIRTY << std::endl
+                << "date   : " << MAKEFILE_BUILD_DATE << std::endl
+                << "hash   : " << MAKEFILE_BUILD_HASH << std::endl << "---" << std::endl;
+            break;
+        }
+
+        case ecb::mode::HELP:
+        case ecb::mode::INVALID:
+        {
+            std::cout << ecb::help_text;
+            break;
+        }
+    }
+
+}
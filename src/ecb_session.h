@@ -0,0 +1,70 @@
+//
+// ECB - session that keeps loaded files between runs
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _ECB_SESSION_H_
+#define _ECB_SESSION_H_
+
+#include <memory>
+
+#include "ecb_arg_handler.h"
+#include "yj_cfg.h"
+
+namespace ecb
+{
+// Runs ECB like the command line tool. While the session is open, schema
+// files and templates are loaded only once and reused by all following runs,
+// e.g. by all `ecb` calls in the startup script of an IOC.
+class EcbSession
+{
+public:
+
+    // Opens the session. Schema files and templates loaded from now on are
+    // kept until the session is closed. Does nothing if the session is
+    // already open.
+    void open();
+
+
+    // Closes the session and releases all loaded schema files and templates.
+    void close();
+
+    bool is_open() const;
+
+
+    // Runs ECB with the command line arguments `argc` and `argv`, `argv[0]`
+    // is the name of the program. Without an open session, all files are
+    // loaded again.
+    void run(
+        int argc,
+        char* argv[]);
+
+
+    // Returns the hits and misses of the template cache of the session.
+    YjTemplateCacheStats get_template_cache_stats();
+
+private:
+    std::unique_ptr<YjConfiguration> yj_cfg_;
+
+    // Runs the mode selected by the arguments in `OBJ_argparser` with
+    // `OBJ_yj_cfg`.
+    void run_mode(
+        ArgHandler& OBJ_argparser,
+        YjConfiguration& OBJ_yj_cfg);
+};
+}
+
+#endif // _ECB_SESSION_H_
@@ -0,0 +1,442 @@
+//
+// ECB - tests for ecb_session module
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "gtest/gtest.h"
+
+#include "ecb_session.h"
+#include "yj_profile.h"
+
+using namespace ecb;
+
+class EcbSessionFixture : public testing::Test
+{
+protected:
+
+    EcbSessionFixture()
+    {
+        dir = std::filesystem::temp_directory_path() / "ecb_session_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+
+        std::ofstream(dir / "schema.json") << R"(
+            {
+              "grandSchema": {"axis": {"axis.type=1": {"required": "axisSchema metaSchema"}}},
+              "metaSchema": {"identifier": "meta", "allowAnySubkey": true},
+              "axisSchema": {
+                "identifier": "axis",
+                "schema": {
+                  "axis.type": {"type": "integer", "default": 1},
+                  "axis.id": {"type": "integer", "required": true}
+                }
+              }
+            })";
+        std::ofstream(dir / "axis.jinja2") << "axis {{ axis.id }}";
+        std::ofstream(dir / "axis1.yaml") << "axis:\n  id: 1\n";
+        std::ofstream(dir / "axis2.yaml") << "axis:\n  id: 2\n";
+    }
+
+    ~EcbSessionFixture()
+    {
+        std::filesystem::remove_all(dir);
+    }
+
+    // Builds `yaml` with `dut1` and returns the generated file. `options`
+    // are added to the command line. The previous output is kept, unless
+    // `rebuild` is true.
+    std::string build(const std::string& yaml, const std::vector<std::string>& options = {},
+        bool rebuild = true)
+    {
+        if (rebuild)
+            std::filesystem::remove(dir / "out.cmd");
+
+        std::vector<std::string> args = {"ecb",
+            "--yaml", (dir / yaml).string(),
+            "--schema", "axis",
+            "--schemafile", (dir / "schema.json").string(),
+            "--template", (dir / "axis.jinja2").string(),
+            "--templatedir", dir.string(),
+            "--output", (dir / "out.cmd").string()};
+        std::vector<char*> argv;
+
+        args.insert(args.end(), options.begin(), options.end());
+
+        for (auto& arg : args)
+            argv.push_back(arg.data());
+
+        dut1.run(argv.size(), argv.data());
+
+        std::stringstream output;
+        output << std::ifstream(dir / "out.cmd").rdbuf();
+
+        return output.str();
+    }
+
+    std::filesystem::path dir;
+    EcbSession dut1;
+};
+
+TEST_F(EcbSessionFixture, reuseTemplates)
+{
+    EXPECT_FALSE(dut1.is_open());
+    EXPECT_TRUE(build("axis1.yaml") == "axis 1");
+    EXPECT_TRUE(dut1.get_template_cache_stats().misses == 0);
+
+    dut1.open();
+    EXPECT_TRUE(dut1.is_open());
+    EXPECT_TRUE(build("axis1.yaml") == "axis 1");
+    EXPECT_TRUE(build("axis2.yaml") == "axis 2");
+
+    auto dut2 = dut1.get_template_cache_stats();
+    EXPECT_TRUE(dut2.misses == 1);
+    EXPECT_TRUE(dut2.hits == 1);
+
+    dut1.close();
+    EXPECT_FALSE(dut1.is_open());
+    EXPECT_TRUE(dut1.get_template_cache_stats().hits == 0);
+    EXPECT_TRUE(build("axis2.yaml") == "axis 2");
+}
+
+TEST_F(EcbSessionFixture, reloadChangedFiles)
+{
+    dut1.open();
+    std::ofstream(dir / "inc.jinja2") << "id {{ axis.id }}";
+    std::ofstream(dir / "axis.jinja2") << "{% include \"inc.jinja2\" %}";
+    std::ofstream(dir / "axis3.yaml") << "axis:\n  type: 1\n";
+    EXPECT_TRUE(build("axis1.yaml") == "id 1");
+    EXPECT_THROW(build("axis3.yaml"), std::runtime_error);
+
+    // included file of the same size, the timestamp is moved in case the
+    // file system has a coarse resolution
+    const auto inc_mtime = std::filesystem::last_write_time(dir / "inc.jinja2");
+    std::ofstream(dir / "inc.jinja2") << "ID {{ axis.id }}";
+    std::filesystem::last_write_time(dir / "inc.jinja2", inc_mtime + std::chrono::seconds(1));
+    EXPECT_TRUE(build("axis1.yaml") == "ID 1");
+    EXPECT_TRUE(dut1.get_template_cache_stats().misses == 2);
+
+    // the edited schema is loaded again
+    std::ofstream(dir / "schema.json") << R"(
+        {
+          "grandSchema": {"axis": {"axis.type=1": {"required": "axisSchema metaSchema"}}},
+          "metaSchema": {"identifier": "meta", "allowAnySubkey": true},
+          "axisSchema": {
+            "identifier": "axis",
+            "schema": {
+              "axis.type": {"type": "integer", "default": 1},
+              "axis.id": {"type": "integer", "default": 7}
+            }
+          }
+        })";
+    EXPECT_TRUE(build("axis3.yaml") == "ID 7");
+    EXPECT_TRUE(dut1.get_template_cache_stats().hits == 1);
+}
+
+TEST_F(EcbSessionFixture, buildMany)
+{
+    std::ofstream(dir / "broken.jinja2") << "axis {{ axis.id ";
+    std::ofstream(dir / "noid.yaml") << "axis:\n  name: x\n";
+
+    // the top level values are used for all items that don't define them
+    std::ofstream manifest(dir / "manifest.yaml");
+    manifest << "schema: axis\n"
+        << "schemafile: " << (dir / "schema.json").string() << "\n"
+        << "template: " << (dir / "axis.jinja2").string() << "\n"
+        << "templatedir: " << dir.string() << "\n"
+        << "build:\n";
+
+    for (int i = 1; i <= 12; ++i)
+    {
+        const std::string output = (dir / ("out" + std::to_string(i) + ".cmd")).string();
+
+        if (i % 4 == 2)
+            manifest << "  - {yaml: " << (dir / "noid.yaml").string() << ", output: " << output
+                << "}\n";
+        else if (i % 4 == 3)
+            manifest << "  - {yaml: " << (dir / "axis1.yaml").string() << ", output: " << output
+                << ", template: " << (dir / "broken.jinja2").string() << "}\n";
+        else
+            manifest << "  - {yaml: " << (dir / ((i % 4 == 0) ? "axis2.yaml" : "axis1.yaml"))
+                .string() << ", output: " << output << "}\n";
+    }
+
+    manifest.close();
+
+    // runs buildmany with `jobs` threads, returns the log output and stores
+    // the error message in `error`
+    auto build_many = [&](const std::string& jobs, std::string& error)
+    {
+        std::vector<std::string> args = {"ecb", "--action", "buildmany",
+            "--manifest", (dir / "manifest.yaml").string(), "--jobs", jobs};
+        std::vector<char*> argv;
+
+        for (auto& arg : args)
+            argv.push_back(arg.data());
+
+        error.clear();
+        testing::internal::CaptureStdout();
+
+        try
+        {
+            dut1.run(argv.size(), argv.data());
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+
+        return testing::internal::GetCapturedStdout();
+    };
+
+    std::string dut2_error;
+    const std::string dut2 = build_many("1", dut2_error);
+
+    // one failing entry does not stop the others
+    for (int i = 1; i <= 12; ++i)
+    {
+        const auto output = dir / ("out" + std::to_string(i) + ".cmd");
+        std::stringstream content;
+        content << std::ifstream(output).rdbuf();
+
+        if ((i % 4 == 2) || (i % 4 == 3))
+            EXPECT_FALSE(std::filesystem::exists(output)) << i;
+        else
+            EXPECT_TRUE(content.str() == ((i % 4 == 0) ? "axis 2" : "axis 1")) << i;
+    }
+
+    // the errors are listed in the order of the manifest
+    EXPECT_TRUE(dut2_error.rfind("build of " + (dir / "noid.yaml").string() + " failed", 0) == 0)
+        << dut2_error;
+    EXPECT_TRUE(std::count(dut2_error.begin(), dut2_error.end(), '\n') == 5) << dut2_error;
+    EXPECT_TRUE(dut2.find("== ECB: INJA") != std::string::npos);
+
+    // the same log output and errors in the same order with several threads
+    for (int i = 1; i <= 12; ++i)
+    {
+        std::filesystem::remove(dir / ("out" + std::to_string(i) + ".cmd"));
+        std::filesystem::remove(dir / ("out" + std::to_string(i) + ".cmd.digest"));
+    }
+
+    std::string dut3_error;
+    EXPECT_TRUE(build_many("4", dut3_error) == dut2);
+    EXPECT_TRUE(dut3_error == dut2_error) << dut3_error;
+
+    // the entries that succeeded are up to date
+    const std::string dut4 = build_many("1", dut2_error);
+    EXPECT_TRUE(build_many("4", dut3_error) == dut4);
+    EXPECT_TRUE(dut3_error == dut2_error) << dut3_error;
+    EXPECT_TRUE(dut4.find("up to date: " + (dir / "out1.cmd").string() + "\n") <
+        dut4.find("up to date: " + (dir / "out4.cmd").string() + "\n"));
+}
+
+TEST_F(EcbSessionFixture, buildManyIncompleteEntry)
+{
+    std::ofstream(dir / "manifest.yaml") << "schema: axis\n"
+        << "build:\n"
+        << "  - {yaml: a.yaml, schemafile: s.json, template: t.jinja2, templatedir: d, output: o}\n"
+        << "  - {yaml: b.yaml, schemafile: s.json, template: t.jinja2, templatedir: d}\n";
+
+    std::vector<std::string> args = {"ecb", "--action", "buildmany",
+        "--manifest", (dir / "manifest.yaml").string()};
+    std::vector<char*> argv;
+
+    for (auto& arg : args)
+        argv.push_back(arg.data());
+
+    try
+    {
+        dut1.run(argv.size(), argv.data());
+        FAIL() << "incomplete entry not detected";
+    }
+    catch (const std::runtime_error& e)
+    {
+        EXPECT_TRUE(std::string(e.what()) == "manifest: key 'output' is missing in entry 2")
+            << e.what();
+    }
+
+    // nothing is built if the manifest is invalid
+    EXPECT_FALSE(std::filesystem::exists("o"));
+}
+
+TEST_F(EcbSessionFixture, profile)
+{
+    EXPECT_TRUE(build("axis1.yaml", {"--profile", (dir / "profile.json").string()}) == "axis 1");
+    EXPECT_TRUE(yj_profile::get_profile() == nullptr);
+
+    std::ifstream profile(dir / "profile.json");
+    const auto dut2 = nlohmann::json::parse(profile);
+    std::vector<std::string> dut3;
+
+    for (const auto& phase : dut2["phases"])
+        dut3.push_back(phase["name"]);
+
+    for (const auto& phase : {"yaml.read", "yaml.plc", "schema.load",
+            "schema.normalize", "schema.check_schema", "template.preprocess", "template.parse",
+            "template.render", "output.write"})
+        EXPECT_TRUE(std::find(dut3.begin(), dut3.end(), phase) != dut3.end()) << phase;
+
+    // the yaml file contains no variables
+    EXPECT_TRUE(std::find(dut3.begin(), dut3.end(), "yaml.variables") == dut3.end());
+
+    EXPECT_TRUE(dut2["counters"]["template_lines_preprocessed"] == 1);
+    EXPECT_TRUE(dut2["counters"]["flatten_calls"] > 0);
+    EXPECT_TRUE(dut2["counters"]["schema_entries_scanned"] > 0);
+    EXPECT_TRUE(dut2["wall_time_us"] > 0.0);
+}
+
+TEST_F(EcbSessionFixture, upToDate)
+{
+    dut1.open();
+    EXPECT_TRUE(build("axis1.yaml", {}, false) == "axis 1");
+    EXPECT_TRUE(std::filesystem::exists(dir / "out.cmd.digest"));
+    EXPECT_TRUE(dut1.get_template_cache_stats().misses == 1);
+
+    // nothing changed, so the template is not rendered again
+    EXPECT_TRUE(build("axis1.yaml", {}, false) == "axis 1");
+    EXPECT_TRUE(dut1.get_template_cache_stats().hits == 0);
+
+    // other arguments
+    EXPECT_TRUE(build("axis2.yaml", {}, false) == "axis 2");
+    EXPECT_TRUE(dut1.get_template_cache_stats().hits == 1);
+
+    // changed yaml file of the same size, the timestamp is moved in case the
+    // file system has a coarse resolution
+    const auto yaml_mtime = std::filesystem::last_write_time(dir / "axis2.yaml");
+    std::ofstream(dir / "axis2.yaml") << "axis:\n  id: 3\n";
+    std::filesystem::last_write_time(dir / "axis2.yaml", yaml_mtime + std::chrono::seconds(1));
+    EXPECT_TRUE(build("axis2.yaml", {}, false) == "axis 3");
+    EXPECT_TRUE(dut1.get_template_cache_stats().hits == 2);
+
+    // touched template with the same content
+    std::ofstream(dir / "axis.jinja2") << "axis {{ axis.id }}";
+    EXPECT_TRUE(build("axis2.yaml", {}, false) == "axis 3");
+    EXPECT_TRUE(dut1.get_template_cache_stats().hits == 2);
+
+    // modified output file of another size
+    std::ofstream(dir / "out.cmd") << "axis 4";
+    EXPECT_TRUE(build("axis2.yaml", {}, false) == "axis 3");
+    EXPECT_TRUE(dut1.get_template_cache_stats().hits == 3);
+}
+
+TEST_F(EcbSessionFixture, readKeys)
+{
+    std::ofstream(dir / "keys.yaml") << "axis:\n  id: 1\n  name: \"it's \\\"x\\\"\"\n"
+        "drive:\n  error: [a, b]\n";
+
+    // runs readkey for `keys` and returns the output file
+    auto read_keys = [&](const std::string& keys, const std::vector<std::string>& options)
+    {
+        std::vector<std::string> args = {"ecb", "--action", "readkey",
+            "--yaml", (dir / "keys.yaml").string(), "--key", keys,
+            "--output", (dir / "keys.txt").string()};
+        std::vector<char*> argv;
+
+        args.insert(args.end(), options.begin(), options.end());
+
+        for (auto& arg : args)
+            argv.push_back(arg.data());
+
+        dut1.run(argv.size(), argv.data());
+
+        std::stringstream output;
+        output << std::ifstream(dir / "keys.txt").rdbuf();
+        return output.str();
+    };
+
+    EXPECT_TRUE(read_keys("axis.id", {}) == "1");
+    EXPECT_TRUE(read_keys("axis.id,axis.x,drive.error.*", {}) == "1\n\na\nb");
+    EXPECT_TRUE(read_keys("axis.*", {"--format", "epicsEnvSet"}) ==
+        "epicsEnvSet(axis_id, \"1\")\nepicsEnvSet(axis_name, \"it's \\\"x\\\"\")");
+    EXPECT_TRUE(read_keys("axis.name,drive.error.1", {"--format", "env"}) ==
+        "axis_name='it'\\''s \"x\"'\ndrive_error_1='b'");
+    EXPECT_TRUE(nlohmann::json::parse(read_keys("axis.id,axis.x", {"--format", "json"})) ==
+        nlohmann::json::parse(R"({"axis.id": 1, "axis.x": null})"));
+
+    // in the order of the patterns, not sorted
+    EXPECT_TRUE(read_keys("axis.x,axis.id", {"--format", "json"}) ==
+        "{\n  \"axis.x\": null,\n  \"axis.id\": 1\n}");
+}
+
+TEST_F(EcbSessionFixture, updateKeys)
+{
+    std::ofstream(dir / "keys.yaml") << "axis:\n  id: 1\n  name: x\n  old: 2\nvar:\n  a: 1\n";
+    std::ofstream(dir / "patch.json") << R"({"axis": {"name": "y", "old": null, "x": 3}})";
+
+    std::vector<std::string> args = {"ecb", "--action", "updatekeys",
+        "--yaml", (dir / "keys.yaml").string(), "--values", "axis.id=5,var.a=a=b\\,c\\\\",
+        "--patch", (dir / "patch.json").string(), "--output", (dir / "keys.yaml").string()};
+    std::vector<char*> argv;
+
+    for (auto& arg : args)
+        argv.push_back(arg.data());
+
+    testing::internal::CaptureStdout();
+    dut1.run(argv.size(), argv.data());
+    const std::string log = testing::internal::GetCapturedStdout();
+
+    std::stringstream output;
+    output << std::ifstream(dir / "keys.yaml").rdbuf();
+
+    EXPECT_TRUE(output.str() == "axis:\n  id: 5\n  name: y\nvar:\n  a: a=b,c\\\n") << output.str();
+    EXPECT_TRUE(log.find("key not found, not updated: axis.x") != std::string::npos) << log;
+
+    // invalid pairs and patches
+    auto run = [&](const std::string& option, const std::string& value)
+    {
+        std::vector<std::string> args = {"ecb", "--action", "updatekeys",
+            "--yaml", (dir / "keys.yaml").string(), option, value};
+        std::vector<char*> argv;
+
+        for (auto& arg : args)
+            argv.push_back(arg.data());
+
+        dut1.run(argv.size(), argv.data());
+    };
+
+    std::ofstream(dir / "list.json") << R"({"axis": {"id": [1]}})";
+    EXPECT_THROW(run("--values", "axis.id"), std::runtime_error);
+    EXPECT_THROW(run("--patch", (dir / "list.json").string()), std::runtime_error);
+    EXPECT_THROW(run("--patch", (dir / "missing.json").string()), std::runtime_error);
+    EXPECT_THROW(run("--fsync", "no"), std::runtime_error);
+}
+
+TEST_F(EcbSessionFixture, compiledSchema)
+{
+    std::vector<std::string> args = {"ecb", "--action", "compileschema",
+        "--schemafile", (dir / "schema.json").string(), "--output", (dir / "schema.bin").string()};
+    std::vector<char*> argv;
+
+    for (auto& arg : args)
+        argv.push_back(arg.data());
+
+    dut1.run(argv.size(), argv.data());
+    ASSERT_TRUE(std::filesystem::exists(dir / "schema.bin"));
+
+    EXPECT_TRUE(build("axis1.yaml", {"--schemafile", (dir / "schema.bin").string()}) == "axis 1");
+
+    // the grand schema and `required` are compiled as well
+    std::ofstream(dir / "axis3.yaml") << "axis:\n  type: 1\n";
+    EXPECT_THROW(build("axis3.yaml", {"--schemafile", (dir / "schema.bin").string()}),
+        std::runtime_error);
+}
@@ -17,13 +17,63 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <thread>
 
 #include "yj_cfg.h"
+#include "yj_common.h"
+#include "yj_file.h"
+#include "yj_profile.h"
 #include "yj_render.h"
 #include "yj_schema.h"
 #include "yj_yaml.h"
 
+// identifies the ECB build that wrote a digest, a new build renders all
+// configurations again
+#define ECB_BUILD_DIGEST_VERSION (MAKEFILE_BUILD_VERSION "-" MAKEFILE_BUILD_HASH MAKEFILE_BUILD_DIRTY \
+    "-" MAKEFILE_BUILD_DATE)
+
+// arguments of `entry` as stored in its digest
+static nlohmann::json
+get_digest_arguments(const ecb::YjBuildEntry& entry)
+{
+    nlohmann::json ret_val;
+    ret_val["directory"] = std::filesystem::current_path().string();
+    ret_val["yaml"] = entry.filename_yaml;
+    ret_val["schemafile"] = entry.filename_schema;
+    ret_val["schema"] = entry.selected_schema;
+    ret_val["template"] = entry.filename_template;
+    ret_val["templatedir"] = entry.template_dir;
+    ret_val["output"] = entry.filename_output;
+
+    return ret_val;
+}
+
+void
+ecb::YjConfiguration::set_fsync(bool sync)
+{
+    sync_output_ = sync;
+}
+
+void
+ecb::YjConfiguration::set_cache_dir(const std::string& cache_dir)
+{
+    render_.set_cache_dir(cache_dir);
+}
+
+ecb::YjTemplateCacheStats
+ecb::YjConfiguration::get_template_cache_stats()
+{
+    return render_.get_template_cache_stats();
+}
+
 std::string
 ecb::YjConfiguration::read_key(
     const std::string& filename_yaml,
@@ -34,6 +84,97 @@ ecb::YjConfiguration::read_key(
     return value;
 }
 
+std::vector<std::string>
+ecb::YjConfiguration::read_keys(
+    const std::string& filename_yaml,
+    const std::vector<std::string>& keys)
+{
+    auto OBJ_yaml = ecb::YjYaml();
+    return OBJ_yaml.read_yaml_keys(filename_yaml, keys);
+}
+
+std::string
+ecb::YjConfiguration::read_keys_formatted(
+    const std::string& filename_yaml,
+    const std::vector<std::string>& patterns,
+    const std::string& format)
+{
+    if ((format != "") && (format != "epicsEnvSet") && (format != "env") && (format != "json"))
+        throw std::runtime_error("unknown format: " + format);
+
+    auto OBJ_yaml = ecb::YjYaml();
+    const auto key_values = OBJ_yaml.select_yaml_keys(filename_yaml, patterns);
+
+    if (format == "json")
+    {
+        // the keys are kept in the order they were selected, not sorted
+        nlohmann::ordered_json ret_val = nlohmann::ordered_json::object();
+
+        for (const auto& key_value : key_values)
+            ret_val[key_value.key] = key_value.value;
+
+        return ret_val.dump(2);
+    }
+
+    std::string ret_val;
+
+    for (size_t i = 0; i < key_values.size(); ++i)
+    {
+        const auto& key_value = key_values[i];
+
+        if (i > 0)
+            ret_val += '\n';
+
+        if (format == "")
+        {
+            ret_val += key_value.text;
+            continue;
+        }
+
+        std::string name = key_value.key;
+
+        for (char& c : name)
+        {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && (c != '_'))
+                c = '_';
+        }
+
+        if (name.empty() || std::isdigit(static_cast<unsigned char>(name.front())))
+            name.insert(0, "_");
+
+        if (format == "epicsEnvSet")
+        {
+            ret_val += "epicsEnvSet(" + name + ", \"";
+
+            for (const char c : key_value.text)
+            {
+                if ((c == '"') || (c == '\\'))
+                    ret_val += '\\';
+
+                ret_val += c;
+            }
+
+            ret_val += "\")";
+        }
+        else
+        {
+            ret_val += name + "='";
+
+            for (const char c : key_value.text)
+            {
+                if (c == '\'')
+                    ret_val += "'\\''";
+                else
+                    ret_val += c;
+            }
+
+            ret_val += "'";
+        }
+    }
+
+    return ret_val;
+}
+
 std::string
 ecb::YjConfiguration::update_key(
     const std::string& filename_yaml,
@@ -45,6 +186,114 @@ ecb::YjConfiguration::update_key(
     return ret_val;
 }
 
+std::vector<ecb::YjKeyUpdate>
+ecb::YjConfiguration::read_key_updates(const std::string& key_values)
+{
+    std::vector<YjKeyUpdate> ret_val;
+    std::string pair;
+    bool is_escaped = false;
+
+    // lambda, adds the pair read so far
+    auto add_pair = [&]()
+    {
+        const size_t pos = pair.find('=');
+
+        if ((pos == std::string::npos) || (pos == 0))
+            throw std::runtime_error("invalid key=value pair: " + pair);
+
+        ret_val.push_back({pair.substr(0, pos), pair.substr(pos + 1)});
+        pair.clear();
+    };
+
+    for (const char c : key_values)
+    {
+        if (is_escaped || ((c != '\\') && (c != ',')))
+        {
+            pair += c;
+            is_escaped = false;
+        }
+        else if (c == '\\')
+            is_escaped = true;
+        else
+            add_pair();
+    }
+
+    if (is_escaped)
+        pair += '\\';
+
+    if (!pair.empty())
+        add_pair();
+
+    return ret_val;
+}
+
+std::vector<ecb::YjKeyUpdate>
+ecb::YjConfiguration::read_patch(const std::string& filename_patch)
+{
+    YjFile patch_file(filename_patch);
+
+    if (!patch_file.is_open())
+        throw std::runtime_error("patch file not found: " + filename_patch);
+
+    const auto patch_content = patch_file.get_content();
+    const auto patch = nlohmann::json::parse(patch_content.begin(), patch_content.end(), nullptr,
+            false);
+
+    if (!patch.is_object())
+        throw std::runtime_error("patch: JSON object expected: " + filename_patch);
+
+    std::vector<YjKeyUpdate> ret_val;
+
+    // lambda, flattens the patch into keys in dot notation
+    auto add_updates = [&](auto& self, const nlohmann::json& object,
+        const std::string& prefix) -> void
+    {
+        for (const auto& [name, value] : object.items())
+        {
+            const std::string key = prefix + name;
+
+            if (value.is_object())
+                self(self, value, key + ".");
+            else if (value.is_array())
+                throw std::runtime_error("patch: lists are not supported: " + key);
+            else if (value.is_null())
+                ret_val.push_back({key, std::nullopt});
+            else if (value.is_string())
+                ret_val.push_back({key, value.template get<std::string>()});
+            else
+                ret_val.push_back({key, value.dump()});
+        }
+    };
+
+    add_updates(add_updates, patch, "");
+    return ret_val;
+}
+
+std::string
+ecb::YjConfiguration::update_keys(
+    const std::string& filename_yaml,
+    std::vector<YjKeyUpdate>& updates)
+{
+    auto OBJ_yaml = ecb::YjYaml();
+    std::string ret_val = OBJ_yaml.update_yaml_keys(filename_yaml, updates);
+
+    for (const auto& update : updates)
+    {
+        if (update.status == YjUpdateStatus::NOT_FOUND)
+            ecb::yj_common::log("warning: key not found, not updated: " + update.key);
+        else if (update.status == YjUpdateStatus::NO_VALUE)
+            ecb::yj_common::log("warning: key has no value, not updated: " + update.key);
+    }
+
+    return ret_val;
+}
+
+std::string
+ecb::YjConfiguration::compile_schema(const std::string& filename_schema)
+{
+    return get_schema(filename_schema).schema->to_binary();
+}
+
 std::string
 ecb::YjConfiguration::build(
     const std::string& filename_yaml,
@@ -53,35 +302,321 @@ ecb::YjConfiguration::build(
     const std::string& filename_template,
     const std::string& template_dir)
 {
+    std::ostringstream output;
+
+    if (!build(filename_yaml, filename_schema, selected_schema, filename_template, template_dir,
+            output))
+        return {};
+
+    return output.str();
+}
+
+bool
+ecb::YjConfiguration::build(
+    const std::string& filename_yaml,
+    const std::string& filename_schema,
+    const std::string& selected_schema,
+    const std::string& filename_template,
+    const std::string& template_dir,
+    std::ostream& output)
+{
+    std::vector<nlohmann::json> dependencies;
+
+    return build(filename_yaml, filename_schema, selected_schema, filename_template, template_dir,
+            output, dependencies);
+}
+
+bool
+ecb::YjConfiguration::build(
+    const std::string& filename_yaml,
+    const std::string& filename_schema,
+    const std::string& selected_schema,
+    const std::string& filename_template,
+    const std::string& template_dir,
+    std::ostream& output,
+    std::vector<nlohmann::json>& dependencies)
+{
+    const auto loaded_schema = get_schema(filename_schema);
     auto OBJ_yaml = ecb::YjYaml();
-    auto OBJ_schema = ecb::YjSchema(filename_schema, selected_schema);
-    auto OBJ_render = ecb::YjRender();
+    auto OBJ_schema = ecb::YjSchema(loaded_schema.schema, selected_schema);
 
     nlohmann::json cfg_data = nlohmann::json();
     OBJ_yaml.read_yaml(filename_yaml, cfg_data);
 
-    // pre-eval axis.type
-    if (selected_schema == "axis")
-        OBJ_schema.add_default_value_from_key(cfg_data, "axis.type");
-    else if ((selected_schema == "plc") || (selected_schema == "encoder"))
-        cfg_data["/meta/schemaNumber"_json_pointer] = 0;
+    // the states of the files as they were read, a file that changes during
+    // the build makes the digest outdated
+    dependencies.insert(dependencies.end(), OBJ_yaml.get_file_states().cbegin(),
+        OBJ_yaml.get_file_states().cend());
+    dependencies.push_back(loaded_schema.file_state);
+
+    const auto validation = OBJ_schema.validate(cfg_data);
+
+    return render_.render(filename_template, template_dir, cfg_data, validation.keys, output,
+            dependencies);
+}
+
+bool
+ecb::YjConfiguration::build_to_file(const YjBuildEntry& entry)
+{
+    if (is_up_to_date(entry))
+    {
+        ecb::yj_common::log("up to date: " + entry.filename_output);
+        return false;
+    }
+
+    // a digest of an older build must not survive a failing build
+    std::error_code error;
+    std::filesystem::remove(entry.filename_output + ".digest", error);
+
+    // a failing build leaves the previous output untouched
+    std::vector<nlohmann::json> dependencies;
+
+    {
+        YjOutputFile output(entry.filename_output, sync_output_);
+
+        if (!build(entry.filename_yaml, entry.filename_schema, entry.selected_schema,
+                entry.filename_template, entry.template_dir, output.stream(), dependencies))
+            return true;
+
+        YjProfileTimer timer("output.write");
+        output.commit();
+    }
+
+    dependencies.push_back(ecb::yj_common::get_file_state(entry.filename_output));
+    write_digest(entry, dependencies);
+
+    return true;
+}
+
+bool
+ecb::YjConfiguration::is_up_to_date(const YjBuildEntry& entry)
+{
+    YjFile digest_file(entry.filename_output + ".digest");
+
+    if (!digest_file.is_open())
+        return false;
+
+    const auto digest_content = digest_file.get_content();
+    const auto digest = nlohmann::json::parse(digest_content.begin(), digest_content.end(), nullptr,
+            false);
+
+    try
+    {
+        if ((digest.at("ecb") != ECB_BUILD_DIGEST_VERSION)
+            || (digest.at("arguments") != get_digest_arguments(entry)))
+            return false;
+
+        for (const auto& dependency : digest.at("dependencies"))
+        {
+            if (!ecb::yj_common::is_file_unchanged(dependency))
+                return false;
+        }
+
+        return true;
+    }
+    catch (const nlohmann::json::exception&)
+    {
+        // damaged or incompatible digest
+        return false;
+    }
+}
+
+void
+ecb::YjConfiguration::write_digest(const YjBuildEntry& entry,
+    const std::vector<nlohmann::json>& dependencies)
+{
+    nlohmann::json digest;
+    digest["ecb"] = ECB_BUILD_DIGEST_VERSION;
+    digest["arguments"] = get_digest_arguments(entry);
+    digest["dependencies"] = nlohmann::json::array();
+
+    for (const auto& dependency : dependencies)
+    {
+        if (dependency.is_null())
+            return;
+
+        digest["dependencies"].push_back(dependency);
+    }
+
+    std::string filename = entry.filename_output + ".digest";
+    std::string data = digest.dump(2);
+    ecb::yj_common::write_file(filename, data);
+}
+
+std::vector<ecb::YjBuildEntry>
+ecb::YjConfiguration::read_manifest(const std::string& filename_manifest)
+{
+    YjFile manifest_content(filename_manifest, YjFileAccess::COPY_ON_WRITE);
+
+    if (!manifest_content.is_open())
+        throw std::runtime_error("manifest file not found: " + filename_manifest);
+
+    auto OBJ_yaml = ecb::YjYaml();
+    nlohmann::json manifest;
+    OBJ_yaml.read_bare_yaml(manifest_content.data(), manifest_content.size(), manifest);
+
+    if (!manifest.contains("build") || !manifest["build"].is_array())
+        throw std::runtime_error("manifest: list 'build' is missing: " + filename_manifest);
+
+    std::vector<ecb::YjBuildEntry> ret_val;
+    ret_val.reserve(manifest["build"].size());
+
+    for (const auto& item : manifest["build"])
+    {
+        // lambda, items override the top level values of the manifest
+        auto get_value = [&](const std::string& key)
+        {
+            if (item.is_object() && item.contains(key))
+                return item[key].get<std::string>();
+
+            if (manifest.contains(key))
+                return manifest[key].get<std::string>();
+
+            throw std::runtime_error("manifest: key '" + key + "' is missing in entry " +
+                std::to_string(ret_val.size() + 1));
+        };
+
+        ecb::YjBuildEntry entry;
+        entry.filename_yaml = get_value("yaml");
+        entry.filename_schema = get_value("schemafile");
+        entry.selected_schema = get_value("schema");
+        entry.filename_template = get_value("template");
+        entry.template_dir = get_value("templatedir");
+        entry.filename_output = get_value("output");
+
+        ret_val.push_back(std::move(entry));
+    }
+
+    return ret_val;
+}
+
+void
+ecb::YjConfiguration::build_many(const std::vector<YjBuildEntry>& entries, unsigned int jobs)
+{
+    // state of one entry, written by the worker thread that builds it
+    struct BuildResult
+    {
+        std::ostringstream log;
+        std::string error;
+        bool done = false;
+    };
+
+    std::vector<BuildResult> results(entries.size());
+    std::mutex profile_mutex;
+    YjProfile* profile = yj_profile::get_profile();
+    std::atomic<size_t> next_entry{0};
+    std::mutex done_mutex;
+    std::condition_variable done_condition;
+
+    if (jobs == 0)
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    jobs = std::min(static_cast<size_t>(jobs), entries.size());
+
+    // lambda, each worker builds the next entry that is not yet taken
+    auto worker = [&]()
+    {
+        // each worker records its own profile, it is added to the profile of
+        // the calling thread when the worker is done
+        YjProfile worker_profile;
+
+        if (profile != nullptr)
+            yj_profile::record(&worker_profile);
+
+        for (size_t i = next_entry++; i < entries.size(); i = next_entry++)
+        {
+            const auto& entry = entries[i];
+            auto& result = results[i];
+
+            ecb::yj_common::redirect_log(&result.log);
+
+            try
+            {
+                build_to_file(entry);
+            }
+            catch (const std::exception& e)
+            {
+                result.error = "build of " + entry.filename_yaml + " failed: " + e.what();
+            }
+
+            ecb::yj_common::redirect_log(nullptr);
+
+            {
+                std::lock_guard<std::mutex> lock(done_mutex);
+                result.done = true;
+            }
+
+            done_condition.notify_all();
+        }
+
+        if (profile != nullptr)
+        {
+            yj_profile::record(nullptr);
+
+            std::lock_guard<std::mutex> lock(profile_mutex);
+            profile->merge(worker_profile);
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (unsigned int i = 0; i < jobs; ++i)
+        workers.emplace_back(worker);
+
+    // print the log output in the order of the manifest
+    std::string errors;
+
+    for (auto& result : results)
+    {
+        {
+            std::unique_lock<std::mutex> lock(done_mutex);
+            done_condition.wait(lock, [&result] { return result.done; });
+        }
+
+        ecb::yj_common::log_stream() << result.log.str();
+
+        if (!result.error.empty())
+            errors += (errors.empty() ? "" : "\n") + result.error;
+    }
+
+    for (auto& worker_thread : workers)
+        worker_thread.join();
+
+    if (!errors.empty())
+        throw std::runtime_error(errors);
+}
+
+ecb::YjLoadedSchema
+ecb::YjConfiguration::get_schema(const std::string& filename_schema)
+{
+    YjLoadedSchema cached_schema;
+
+    {
+        std::lock_guard<std::mutex> lock(schemas_mutex_);
+
+        if (auto it = schemas_.find(filename_schema); it != schemas_.end())
+            cached_schema = it->second;
+    }
 
-    OBJ_schema.normalize(cfg_data);
+    // a schema file edited during a session is loaded again
+    if ((cached_schema.schema != nullptr) && !cached_schema.file_state.is_null()
+        && ecb::yj_common::is_file_unchanged(cached_schema.file_state))
+        return cached_schema;
 
-    OBJ_schema.add_schema_default_values(cfg_data);
-    OBJ_schema.check_and_normalize_datatypes(cfg_data);
-    OBJ_schema.normalize(cfg_data);
+    // the schema is read and compiled without holding the lock, so other
+    // threads can use the loaded schemas in the meantime
+    YjLoadedSchema loaded_schema;
+    loaded_schema.schema = ecb::YjSchema::load_schema(filename_schema, loaded_schema.file_state);
 
-    if (selected_schema == "axis")
-        cfg_data["/meta/schemaNumber"_json_pointer] = cfg_data["/axis/type"_json_pointer];
+    std::lock_guard<std::mutex> lock(schemas_mutex_);
+    auto it = schemas_.find(filename_schema);
 
-    OBJ_schema.check_min_max_ranges(cfg_data);
-    OBJ_schema.check_schema(selected_schema, cfg_data);
-    OBJ_schema.check_for_valid_keys(cfg_data);
-    OBJ_schema.remove_undefined_keys(cfg_data);
+    // another thread may have loaded the same schema in the meantime
+    if ((it != schemas_.end()) && (it->second.schema != cached_schema.schema))
+        return it->second;
 
-    const std::string configuration = OBJ_render.render(filename_template, template_dir, cfg_data);
+    schemas_[filename_schema] = loaded_schema;
 
-    return configuration;
+    return loaded_schema;
 }
 
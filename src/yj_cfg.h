@@ -19,10 +19,44 @@
 #ifndef _YJ_CFG_H_
 #define _YJ_CFG_H_
 
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <ostream>
 #include <string>
+#include <vector>
+
+#include "yj_render.h"
+#include "yj_schema_index.h"
+#include "yj_yaml.h"
 
 namespace ecb
 {
+// One configuration of a build manifest (see `read_manifest`). The members
+// correspond to the command line arguments of the `build` action.
+struct YjBuildEntry
+{
+    std::string filename_yaml;
+    std::string filename_schema;
+    std::string selected_schema;
+    std::string filename_template;
+    std::string template_dir;
+    std::string filename_output;
+};
+
+
+// A schema loaded by `YjConfiguration`.
+struct YjLoadedSchema
+{
+    std::shared_ptr<const YjSchemaIndex> schema;
+
+    // state of the schema file as it was read, see
+    // `yj_common::get_file_state`
+    nlohmann::json file_state;
+};
+
+
 class YjConfiguration
 {
 public:
@@ -36,12 +70,93 @@ public:
         const std::string& filename_template,
         const std::string& template_dir);
 
+    // Same as above, but the configuration is written to `output` while it
+    // is rendered. Returns false if the rendering failed and `output`
+    // contains an incomplete configuration (see `YjRender::render`).
+    bool build(
+        const std::string& filename_yaml,
+        const std::string& filename_schema,
+        const std::string& selected_schema,
+        const std::string& filename_template,
+        const std::string& template_dir,
+        std::ostream& output);
+
+    // Builds the configuration `entry` and writes it to its output file.
+    // The output file is replaced atomically and keeps its modification
+    // time if the configuration is unchanged (see `YjOutputFile`). Next to
+    // the output file a digest `<output>.digest` is written, which lists
+    // the arguments and all files the output depends on: the YAML file, the
+    // PLC file referenced by `plc.file`, the schema file, the template and
+    // all files it includes, and the output file itself. If the digest
+    // matches and none of these files has changed, the build is skipped and
+    // "up to date" is logged. Returns false if the build was skipped.
+    bool build_to_file(
+        const YjBuildEntry& entry);
+
+    // Reads the build manifest `filename_manifest` and returns its entries
+    // in the order of the manifest. The manifest is a YAML file with a list
+    // `build`, each item of this list defines one configuration with the
+    // keys `yaml`, `schema`, `schemafile`, `template`, `templatedir` and
+    // `output`. These keys can also be defined at the top level of the
+    // manifest, where they are used for all items that don't define them.
+    // Throws an exception if an item is incomplete.
+    std::vector<YjBuildEntry> read_manifest(
+        const std::string& filename_manifest);
+
+    // Builds all configurations in `entries` and writes each of them to its
+    // output file. Each schema file and template is loaded only once, no
+    // matter how many entries use it. The entries are built by `jobs`
+    // threads, 0 means one thread per CPU core. The log output of each entry
+    // is printed in the order of `entries`, so the result does not depend on
+    // the number of threads. All entries are built even if some of them
+    // fail; afterwards an exception is thrown that names the failing entries
+    // in the order of `entries`.
+    void build_many(
+        const std::vector<YjBuildEntry>& entries,
+        unsigned int jobs = 0);
+
+    // Stores preprocessed templates in the directory `cache_dir`, so that
+    // later calls of ECB can reuse them (see YjRender::set_cache_dir). An
+    // empty string disables the cache.
+    void set_cache_dir(
+        const std::string& cache_dir);
+
+    // Flushes output files to the disk before they replace the previous
+    // output (see `YjOutputFile`). Disabled by default.
+    void set_fsync(
+        bool sync);
+
+    // Returns the hits and misses of the template cache.
+    YjTemplateCacheStats get_template_cache_stats();
+
     // Reads the value of a key from the given YAML file and returns it as a
     // string.  If the key is not defined, an emptry string is returned.
     std::string read_key(
         const std::string& filename_yaml,
         const std::string& key);
 
+    // Reads the values of `keys` from the given YAML file, which is read only
+    // once. The values are returned in the order of `keys`, see `read_key`.
+    std::vector<std::string> read_keys(
+        const std::string& filename_yaml,
+        const std::vector<std::string>& keys);
+
+    // Reads the keys selected by `patterns` from the given YAML file, which
+    // is read only once (see `YjYaml::select_yaml_keys`), and returns them
+    // in `format`:
+    //   ""            the values, one per line
+    //   "epicsEnvSet" `epicsEnvSet(NAME, "VALUE")` per key, for iocsh
+    //   "env"         `NAME='VALUE'` per key, for a shell
+    //   "json"        a JSON object with the keys and their values, in the
+    //                 same order as for the other formats
+    // NAME is the key with all characters except letters, digits and `_`
+    // replaced by `_`, e.g. `axis_id` for `axis.id`. Undefined keys have an
+    // empty value, or null in JSON. Throws an exception for an unknown format.
+    std::string read_keys_formatted(
+        const std::string& filename_yaml,
+        const std::vector<std::string>& patterns,
+        const std::string& format);
+
     // Updates the value of the specified key in the given YAML file. If the
     // key is not defined, it is not added. In this case the unmodified YAML
     // file is returned.
@@ -49,6 +164,76 @@ public:
         const std::string& filename_yaml,
         const std::string& key,
         const std::string& value);
+
+    // Parses `key_values`, a comma separated list of `key=value` pairs, into
+    // updates for `update_keys`. Each pair is split at its first `=`, so the
+    // value can contain `=`. A `,` or `\` that is part of a value is escaped
+    // with `\`, e.g. `axis.name=a\,b`. Throws an exception if a pair has no
+    // `=` or an empty key.
+    std::vector<YjKeyUpdate> read_key_updates(
+        const std::string& key_values);
+
+    // Reads the JSON merge patch (RFC 7396) `filename_patch` into updates for
+    // `update_keys`. Nested objects address nested keys, null removes a key.
+    // Throws an exception if the patch is not a JSON object or contains a
+    // list, since lists cannot be merged into existing keys.
+    std::vector<YjKeyUpdate> read_patch(
+        const std::string& filename_patch);
+
+    // Applies all `updates` to the given YAML file, which is parsed and
+    // emitted only once (see `YjYaml::update_yaml_keys`), and returns the
+    // modified YAML content. Like with `update_key`, keys that are not
+    // defined are not added; a warning is logged for each of them.
+    std::string update_keys(
+        const std::string& filename_yaml,
+        std::vector<YjKeyUpdate>& updates);
+
+    // Compiles the schema file `filename_schema` and returns it in the binary
+    // schema format (see `YjSchemaIndex::to_binary`). A binary schema can be
+    // used like the schema file, its tables are decoded instead of parsing
+    // and compiling the schema again.
+    std::string compile_schema(
+        const std::string& filename_schema);
+
+private:
+    // Schemas loaded so far, the key is the filename of the schema file.
+    std::map<std::string, YjLoadedSchema> schemas_;
+    std::mutex schemas_mutex_;
+    YjRender render_;
+    bool sync_output_ = false;
+
+    // Implements `build`, the states of the files the configuration depends
+    // on, as they were read for this build (see
+    // `yj_common::get_file_state`), are appended to `dependencies`.
+    bool build(
+        const std::string& filename_yaml,
+        const std::string& filename_schema,
+        const std::string& selected_schema,
+        const std::string& filename_template,
+        const std::string& template_dir,
+        std::ostream& output,
+        std::vector<nlohmann::json>& dependencies);
+
+    // Returns true if the digest of `entry` matches its arguments and none
+    // of the files listed in the digest has changed.
+    bool is_up_to_date(
+        const YjBuildEntry& entry);
+
+    // Writes the digest of `entry` with the file states `dependencies`. No
+    // digest is written if one of the states is null, i.e. a file could not
+    // be read, so the next build is not skipped.
+    void write_digest(
+        const YjBuildEntry& entry,
+        const std::vector<nlohmann::json>& dependencies);
+
+    // Returns the schema loaded from `filename_schema`. The file is only read
+    // on the first call, subsequent calls return the same schema as long as
+    // the file is unchanged. Can be called from several threads at the same
+    // time. The schema is loaded without holding `schemas_mutex_`; threads
+    // that load the same schema concurrently all return the one that was
+    // stored first.
+    YjLoadedSchema get_schema(
+        const std::string& filename_schema);
 };
 }
 
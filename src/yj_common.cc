@@ -16,17 +16,24 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <regex>
 #include <filesystem>
 
 #include "yj_common.h"
+#include "yj_file.h"
+#include "yj_profile.h"
 
 const std::regex ecb::yj_common::REGEX_token_sep_dot = std::regex(R"(\.+)");
 const std::regex ecb::yj_common::REGEX_token_sep_space = std::regex(
         R"(\s+)");
 
+// log output of the current thread, nullptr means std::cout
+static thread_local std::ostream* log_stream_ = nullptr;
+
 
 std::vector<std::string>
 ecb::yj_common::tokenize(std::string value, const std::regex regex_expr)
@@ -79,7 +86,19 @@ ecb::yj_common::remove_whitespaces(std::string& line)
 void
 ecb::yj_common::log(const std::string txt)
 {
-    std::cout << "<-ECB-> " << txt << std::endl;
+    log_stream() << "<-ECB-> " << txt << std::endl;
+}
+
+std::ostream&
+ecb::yj_common::log_stream()
+{
+    return (log_stream_ == nullptr) ? std::cout : *log_stream_;
+}
+
+void
+ecb::yj_common::redirect_log(std::ostream* stream)
+{
+    log_stream_ = stream;
 }
 
 std::string
@@ -106,24 +125,75 @@ ecb::yj_common::generate_json_pointer(
     return json_ptr;
 }
 
-void
-ecb::yj_common::write_file(std::string& filename, std::string& data)
+std::string
+ecb::yj_common::hash(std::string_view data)
 {
-    std::filesystem::path file(filename);
+    uint64_t value = 14695981039346656037ULL;
 
-    if (file.has_parent_path())
+    for (const char c : data)
     {
-        std::filesystem::path dir(filename);
-        std::filesystem::create_directories(dir.remove_filename());
+        value ^= static_cast<unsigned char>(c);
+        value *= 1099511628211ULL;
     }
 
-    std::ofstream out_file(file);
+    char ret_val[17];
+    std::snprintf(ret_val, sizeof(ret_val), "%016llx", static_cast<unsigned long long>(value));
 
-    if (out_file.is_open())
-    {
-        out_file << data;
-        out_file.close();
-    }
-    else
-        throw std::runtime_error("could not create file: " + filename);
+    return ret_val;
+}
+
+nlohmann::json
+ecb::yj_common::get_file_state(const std::string& filename)
+{
+    return get_file_state(YjFile(filename));
+}
+
+nlohmann::json
+ecb::yj_common::get_file_state(const YjFile& file)
+{
+    nlohmann::json ret_val;
+    std::filesystem::file_time_type mtime;
+
+    if (!file.is_open() || !file.get_mtime(mtime))
+        return ret_val;
+
+    ret_val["file"] = file.get_filename();
+    ret_val["size"] = file.size();
+    ret_val["mtime"] = mtime.time_since_epoch().count();
+    ret_val["hash"] = hash(file.get_content());
+
+    return ret_val;
+}
+
+bool
+ecb::yj_common::is_file_unchanged(const nlohmann::json& state)
+{
+    const std::string filename = state.at("file");
+    std::error_code error;
+
+    const auto size = std::filesystem::file_size(filename, error);
+
+    if (error || (state.at("size") != size))
+        return false;
+
+    const auto mtime = std::filesystem::last_write_time(filename, error);
+
+    if (error)
+        return false;
+
+    // the file is only read if it was touched
+    if (state.at("mtime") == mtime.time_since_epoch().count())
+        return true;
+
+    return (get_file_state(filename).value("hash", "") == state.at("hash"));
+}
+
+void
+ecb::yj_common::write_file(std::string& filename, std::string& data, bool sync)
+{
+    YjProfileTimer timer("output.write");
+    YjOutputFile out_file(filename, sync);
+
+    out_file.stream() << data;
+    out_file.commit();
 }
@@ -20,7 +20,9 @@
 #ifndef _YJ_COMMON_H_
 #define _YJ_COMMON_H_
 
+#include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <regex>
 
@@ -29,6 +31,8 @@
 
 namespace ecb
 {
+class YjFile;
+
 namespace yj_common
 {
 
@@ -60,6 +64,16 @@ void remove_whitespaces(
 // add entry to output log
 void log(
     std::string txt);
+
+// Returns the stream for log output of the calling thread. This is
+// std::cout, unless it was redirected with `redirect_log`.
+std::ostream& log_stream();
+
+// Redirects the log output of the calling thread to `stream`. Passing
+// nullptr restores the output to std::cout. Used to collect the output of
+// builds running in parallel, so it can be printed in a defined order.
+void redirect_log(
+    std::ostream* stream);
 //
 // Returns a JSON pointer to be used with the nlohmann::json.  The expected
 // input key format is "a.b.c".
@@ -70,11 +84,38 @@ nlohmann::json::json_pointer generate_json_pointer(
 std::string cfg_key_to_json_key_string(
     std::string key);
 
+// Returns the 64 bit FNV-1a hash of `data` as hexadecimal string.
+std::string hash(
+    std::string_view data);
+
+// Returns the size, modification time and hash of `filename` as JSON object
+// with the keys `file`, `size`, `mtime` and `hash`, or null if the file
+// cannot be read.
+nlohmann::json get_file_state(
+    const std::string& filename);
+
+// Same as above for the content that was read into `file`. The state
+// describes exactly this content, even if the file was modified after it
+// was read. Call it before the content is modified in place.
+nlohmann::json get_file_state(
+    const YjFile& file);
+
+// Returns true if the file described by `state` (see `get_file_state`) still
+// has the same content. The file is only read if its size is the same but
+// its modification time differs. Throws a nlohmann::json exception if
+// `state` is incomplete.
+bool is_file_unchanged(
+    const nlohmann::json& state);
+
 // write `data` to `filename`. If the parent path to `filename` does not exist,
-// it will be created. Throws an exception if `filename` cannot be created.
+// it will be created. The file is replaced atomically and left untouched if
+// it already contains `data`, see `YjOutputFile`. If `sync` is true, the
+// file is flushed to the disk. Throws an exception if `filename` cannot be
+// created.
 void write_file(
     std::string& filename,
-    std::string& data);
+    std::string& data,
+    bool sync = false);
 }
 }
 
@@ -0,0 +1,292 @@
+//
+// ECB - memory mapped input files
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "yj_file.h"
+
+
+// Returns true if the files `filename1` and `filename2` exist and have the
+// same content. The content is only compared if the sizes are equal.
+static bool
+is_same_content(const std::string& filename1, const std::string& filename2)
+{
+    struct stat stat1;
+    struct stat stat2;
+
+    if ((::stat(filename1.c_str(), &stat1) != 0) || (::stat(filename2.c_str(), &stat2) != 0)
+        || (stat1.st_size != stat2.st_size))
+        return false;
+
+    const ecb::YjFile file1(filename1);
+    const ecb::YjFile file2(filename2);
+
+    return file1.is_open() && file2.is_open() && (file1.size() == file2.size())
+        && (std::memcmp(file1.get_content().data(), file2.get_content().data(), file1.size()) == 0);
+}
+
+// Returns the file a symbolic link `filename` finally points to, or
+// `filename` if it is no link. The target does not need to exist.
+static std::filesystem::path
+resolve_symlink(const std::filesystem::path& filename)
+{
+    std::filesystem::path ret_val = filename;
+    std::error_code error;
+
+    // the limit stops link loops, opening the file fails for them anyway
+    for (int i = 0; (i < 40) && std::filesystem::is_symlink(ret_val, error); ++i)
+    {
+        const auto target = std::filesystem::read_symlink(ret_val, error);
+
+        if (error)
+            break;
+
+        ret_val = target.is_absolute() ? target : ret_val.parent_path() / target;
+    }
+
+    return ret_val;
+}
+
+// Flushes the file or directory `filename` to the disk.
+static void
+sync_file(const std::string& filename)
+{
+    const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+        throw std::runtime_error("could not sync file: " + filename);
+
+    const int result = ::fsync(fd);
+    ::close(fd);
+
+    if (result != 0)
+        throw std::runtime_error("could not sync file: " + filename);
+}
+
+
+ecb::YjFile::YjFile(const std::string& filename, YjFileAccess access)
+    : filename_(filename)
+{
+    // before the content is read, so a file modified while it is read
+    // never looks unchanged
+    std::error_code error;
+    mtime_ = std::filesystem::last_write_time(filename, error);
+    has_mtime_ = !error;
+
+    const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+        return;
+
+    struct stat file_stat;
+
+    if ((::fstat(fd, &file_stat) == 0) && S_ISREG(file_stat.st_mode) && (file_stat.st_size > 0))
+    {
+        const int protection = (access == YjFileAccess::COPY_ON_WRITE) ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        void* mapping = ::mmap(nullptr, file_stat.st_size, protection, MAP_PRIVATE, fd, 0);
+
+        if (mapping != MAP_FAILED)
+        {
+            data_ = static_cast<char*>(mapping);
+            size_ = file_stat.st_size;
+            is_mapped_ = true;
+            is_open_ = true;
+        }
+    }
+
+    // pipes, empty files and files that cannot be mapped
+    if (!is_mapped_)
+    {
+        char chunk[65536];
+        ssize_t count;
+
+        while (((count = ::read(fd, chunk, sizeof(chunk))) > 0) || ((count < 0) && (errno == EINTR)))
+        {
+            if (count > 0)
+                buffer_.append(chunk, count);
+        }
+
+        if (count == 0)
+        {
+            data_ = buffer_.data();
+            size_ = buffer_.size();
+            is_open_ = true;
+        }
+    }
+
+    ::close(fd);
+}
+
+ecb::YjFile::~YjFile()
+{
+    if (is_mapped_)
+        ::munmap(data_, size_);
+}
+
+bool
+ecb::YjFile::is_open() const
+{
+    return is_open_;
+}
+
+std::string_view
+ecb::YjFile::get_content() const
+{
+    return std::string_view(data_, size_);
+}
+
+char*
+ecb::YjFile::data()
+{
+    return data_;
+}
+
+size_t
+ecb::YjFile::size() const
+{
+    return size_;
+}
+
+std::vector<std::string>
+ecb::YjFile::get_lines() const
+{
+    std::vector<std::string> ret_val;
+    const std::string_view content = get_content();
+
+    for (size_t start = 0; start < content.size();)
+    {
+        size_t end = content.find('\n', start);
+
+        if (end == std::string_view::npos)
+            end = content.size();
+
+        ret_val.emplace_back(content.substr(start, end - start));
+        start = end + 1;
+    }
+
+    return ret_val;
+}
+
+const std::string&
+ecb::YjFile::get_filename() const
+{
+    return filename_;
+}
+
+bool
+ecb::YjFile::get_mtime(std::filesystem::file_time_type& mtime) const
+{
+    mtime = mtime_;
+    return has_mtime_;
+}
+
+ecb::YjOutputFile::YjOutputFile(const std::string& filename, bool sync)
+    : filename_(filename), sync_(sync)
+{
+    // a link is kept, the file it points to is replaced
+    const std::filesystem::path path = resolve_symlink(filename);
+    target_ = path.string();
+
+    if (path.has_parent_path() && !std::filesystem::exists(path.parent_path()))
+        std::filesystem::create_directories(path.parent_path());
+
+    // unique per object, so concurrent writers in the same process, e.g. the
+    // threads of `buildmany`, never share a temporary file
+    static std::atomic<unsigned long> temporary_count{0};
+    int fd;
+
+    do
+    {
+        filename_temporary_ = target_ + "." + std::to_string(::getpid()) + "."
+            + std::to_string(temporary_count++) + ".tmp";
+        fd = ::open(filename_temporary_.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    }
+    while ((fd < 0) && (errno == EEXIST));
+
+    if (fd < 0)
+        throw std::runtime_error("could not create file: " + filename);
+
+    // the replaced file keeps its permissions
+    struct stat file_stat;
+
+    if ((::stat(target_.c_str(), &file_stat) == 0) && S_ISREG(file_stat.st_mode))
+        ::fchmod(fd, file_stat.st_mode & 07777);
+
+    ::close(fd);
+    stream_.open(filename_temporary_, std::ios::binary);
+
+    if (!stream_.is_open())
+    {
+        ::unlink(filename_temporary_.c_str());
+        throw std::runtime_error("could not create file: " + filename);
+    }
+}
+
+ecb::YjOutputFile::~YjOutputFile()
+{
+    if (!is_committed_)
+    {
+        stream_.close();
+        ::unlink(filename_temporary_.c_str());
+    }
+}
+
+std::ostream&
+ecb::YjOutputFile::stream()
+{
+    return stream_;
+}
+
+bool
+ecb::YjOutputFile::commit()
+{
+    stream_.close();
+
+    if (stream_.fail())
+        throw std::runtime_error("could not write file: " + filename_);
+
+    if (is_same_content(filename_temporary_, target_))
+    {
+        // the temporary file is removed by the destructor
+        return false;
+    }
+
+    if (sync_)
+        sync_file(filename_temporary_);
+
+    if (::rename(filename_temporary_.c_str(), target_.c_str()) != 0)
+        throw std::runtime_error("could not write file: " + filename_ + ": " + std::strerror(errno));
+
+    is_committed_ = true;
+
+    if (sync_)
+    {
+        const std::filesystem::path parent = std::filesystem::path(target_).parent_path();
+        sync_file(parent.empty() ? "." : parent.string());
+    }
+
+    return true;
+}
@@ -0,0 +1,153 @@
+//
+// ECB - memory mapped input files
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _YJ_FILE_H_
+#define _YJ_FILE_H_
+
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ecb
+{
+// How the content of a `YjFile` can be accessed.
+enum class YjFileAccess
+{
+    // the content can only be read
+    READ_ONLY,
+
+    // the content can be modified, changes are private to the object and
+    // never written back to the file
+    COPY_ON_WRITE,
+};
+
+
+// Content of an input file. Regular files are mapped into memory, so the
+// parsers can work on the file without copying it. Other files, e.g. pipes,
+// and files that cannot be mapped are read into a buffer. The file must not
+// be truncated while it is mapped.
+class YjFile
+{
+public:
+
+    // Opens the file `filename`. Use `is_open` to check whether the file
+    // could be read.
+    explicit YjFile(
+        const std::string& filename,
+        YjFileAccess access = YjFileAccess::READ_ONLY);
+
+    ~YjFile();
+
+    YjFile(const YjFile&) = delete;
+    YjFile& operator=(const YjFile&) = delete;
+
+
+    // Returns true if the file could be read.
+    bool is_open() const;
+
+
+    // Returns the content of the file. The content is valid as long as the
+    // object exists.
+    std::string_view get_content() const;
+
+
+    // Returns the modifiable content of a file opened with
+    // `YjFileAccess::COPY_ON_WRITE`.
+    char* data();
+
+    size_t size() const;
+
+
+    // Returns the lines of the file without line terminators, split like
+    // `std::getline` does.
+    std::vector<std::string> get_lines() const;
+
+
+    // Returns the filename the object was opened with.
+    const std::string& get_filename() const;
+
+
+    // Returns the modification time of the file, taken before its content
+    // was read (see `yj_common::get_file_state`). Returns false if it is
+    // unknown.
+    bool get_mtime(
+        std::filesystem::file_time_type& mtime) const;
+
+private:
+    std::string filename_;
+    std::filesystem::file_time_type mtime_;
+    bool has_mtime_ = false;
+    char* data_ = nullptr;
+    size_t size_ = 0;
+    bool is_open_ = false;
+    bool is_mapped_ = false;
+
+    // content of files that are not mapped
+    std::string buffer_;
+};
+
+
+// Output file that is replaced atomically. The content is written to a
+// temporary file next to the output file, which `commit` renames to the
+// output file. If the output file already has the same content, it is left
+// untouched, including its modification time. Readers of the output file
+// therefore never see a partially written file. If the object is destroyed
+// without `commit`, the temporary file is removed. If the output file is a
+// symbolic link, the file it points to is replaced and the link is kept; a
+// replaced file keeps its permissions.
+class YjOutputFile
+{
+public:
+
+    // Creates the temporary file for the output file `filename`. Missing
+    // parent directories are created. If `sync` is true, `commit` flushes
+    // the content to the disk before the file is renamed. Throws an
+    // exception if the temporary file cannot be created.
+    explicit YjOutputFile(
+        const std::string& filename,
+        bool sync = false);
+
+    ~YjOutputFile();
+
+    YjOutputFile(const YjOutputFile&) = delete;
+    YjOutputFile& operator=(const YjOutputFile&) = delete;
+
+
+    // Returns the stream the content is written to.
+    std::ostream& stream();
+
+
+    // Replaces the output file with the written content, unless the content
+    // is unchanged. Returns false if the output file was left untouched.
+    // Throws an exception if the content could not be written.
+    bool commit();
+
+private:
+    std::string filename_;
+    std::string target_;
+    std::string filename_temporary_;
+    std::ofstream stream_;
+    bool sync_ = false;
+    bool is_committed_ = false;
+};
+}
+
+#endif // _YJ_FILE_H_
@@ -0,0 +1,194 @@
+//
+// ECB - tests for yj_file module
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include "gtest/gtest.h"
+
+#include "yj_common.h"
+#include "yj_file.h"
+
+using namespace ecb;
+
+class YjFileFixture : public testing::Test
+{
+protected:
+
+    YjFileFixture()
+    {
+        filename = (std::filesystem::temp_directory_path() / "ecb_yj_file_test.txt").string();
+    }
+
+    ~YjFileFixture()
+    {
+        std::remove(filename.c_str());
+    }
+
+    void write(const std::string& content)
+    {
+        std::ofstream(filename, std::ios::binary) << content;
+    }
+
+    std::string filename;
+};
+
+TEST_F(YjFileFixture, readOnly)
+{
+    write("line1\nline2\r\n\nline4");
+
+    YjFile dut1(filename);
+    ASSERT_TRUE(dut1.is_open());
+    EXPECT_TRUE(dut1.get_content() == "line1\nline2\r\n\nline4");
+    EXPECT_TRUE(dut1.get_lines() == std::vector<std::string>({"line1", "line2\r", "", "line4"}));
+
+    write("line1\n");
+    EXPECT_TRUE(YjFile(filename).get_lines() == std::vector<std::string>({"line1"}));
+}
+
+TEST_F(YjFileFixture, copyOnWrite)
+{
+    write("abc");
+
+    {
+        YjFile dut1(filename, YjFileAccess::COPY_ON_WRITE);
+        ASSERT_TRUE(dut1.is_open());
+        ASSERT_EQ(dut1.size(), 3);
+        dut1.data()[0] = 'x';
+        EXPECT_TRUE(dut1.get_content() == "xbc");
+    }
+
+    // the file is not modified
+    EXPECT_TRUE(YjFile(filename).get_content() == "abc");
+}
+
+TEST_F(YjFileFixture, notMapped)
+{
+    write("");
+
+    YjFile dut1(filename);
+    EXPECT_TRUE(dut1.is_open());
+    EXPECT_TRUE(dut1.get_content().empty());
+    EXPECT_TRUE(dut1.get_lines().empty());
+
+    EXPECT_FALSE(YjFile(filename + ".missing").is_open());
+    EXPECT_FALSE(YjFile(std::filesystem::temp_directory_path().string()).is_open());
+}
+
+TEST_F(YjFileFixture, fileState)
+{
+    write("abc");
+
+    YjFile dut1(filename, YjFileAccess::COPY_ON_WRITE);
+    ASSERT_TRUE(dut1.is_open());
+
+    // replaced after it was read, the state still describes the content
+    // that was read
+    std::ofstream(filename + ".new", std::ios::binary) << "abd";
+    std::filesystem::rename(filename + ".new", filename);
+    std::filesystem::last_write_time(filename,
+        std::filesystem::last_write_time(filename) + std::chrono::seconds(1));
+
+    const auto dut2 = yj_common::get_file_state(dut1);
+    EXPECT_TRUE(dut2["file"] == filename);
+    EXPECT_TRUE(dut2["size"] == 3);
+    EXPECT_TRUE(dut2["hash"] == yj_common::hash("abc"));
+    EXPECT_FALSE(yj_common::is_file_unchanged(dut2));
+    EXPECT_TRUE(yj_common::get_file_state(filename)["hash"] == yj_common::hash("abd"));
+    EXPECT_TRUE(yj_common::is_file_unchanged(yj_common::get_file_state(filename)));
+
+    EXPECT_TRUE(yj_common::get_file_state(YjFile(filename + ".missing")).is_null());
+}
+
+TEST_F(YjFileFixture, outputFile)
+{
+    namespace fs = std::filesystem;
+    const auto old_time = fs::file_time_type::clock::now() - std::chrono::hours(1);
+
+    // new file
+    {
+        YjOutputFile dut1(filename);
+        dut1.stream() << "abc";
+        EXPECT_TRUE(dut1.commit());
+    }
+
+    EXPECT_TRUE(YjFile(filename).get_content() == "abc");
+
+    // unchanged content, the modification time is kept
+    fs::last_write_time(filename, old_time);
+
+    {
+        YjOutputFile dut1(filename, true);
+        dut1.stream() << "abc";
+        EXPECT_FALSE(dut1.commit());
+    }
+
+    EXPECT_TRUE(fs::last_write_time(filename) == old_time);
+
+    // no commit, the file is unchanged
+    {
+        YjOutputFile dut1(filename);
+        dut1.stream() << "xyz";
+    }
+
+    EXPECT_TRUE(YjFile(filename).get_content() == "abc");
+
+    // changed content of the same size
+    {
+        YjOutputFile dut1(filename, true);
+        dut1.stream() << "abd";
+        EXPECT_TRUE(dut1.commit());
+    }
+
+    EXPECT_TRUE(YjFile(filename).get_content() == "abd");
+
+    // no temporary files are left behind
+    for (const auto& entry : fs::directory_iterator(fs::path(filename).parent_path()))
+        EXPECT_TRUE(entry.path().string().rfind(filename + ".", 0) != 0) << entry.path();
+}
+
+TEST_F(YjFileFixture, outputFileLinkAndMode)
+{
+    namespace fs = std::filesystem;
+    const std::string link = filename + ".link";
+    write("abc");
+    fs::permissions(filename, fs::perms::owner_read | fs::perms::owner_write
+        | fs::perms::owner_exec | fs::perms::group_read);
+    fs::remove(link);
+    fs::create_symlink(fs::path(filename).filename(), link);
+
+    // several objects for the same file at the same time
+    {
+        YjOutputFile dut1(link);
+        YjOutputFile dut2(link);
+        dut1.stream() << "xyz1";
+        dut2.stream() << "xyz2";
+        EXPECT_TRUE(dut1.commit());
+        EXPECT_TRUE(dut2.commit());
+    }
+
+    // the link is kept, the file it points to keeps its permissions
+    EXPECT_TRUE(fs::is_symlink(link));
+    EXPECT_TRUE(YjFile(filename).get_content() == "xyz2");
+    EXPECT_TRUE(fs::status(filename).permissions() == (fs::perms::owner_read
+            | fs::perms::owner_write | fs::perms::owner_exec | fs::perms::group_read));
+
+    fs::remove(link);
+}
@@ -0,0 +1,164 @@
+//
+// ECB - sorted index of the keys of a configuration
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "yj_key_index.h"
+
+
+ecb::YjKeyIndex::YjKeyIndex(const nlohmann::json& data)
+{
+    std::string path;
+
+    // lambda, adds `node` with the JSON pointer `path` and all its children
+    auto add_node = [&](const nlohmann::json& node, auto& add_children) -> void
+    {
+        // like `flatten()`, empty lists and objects are values without children
+        if (!node.is_structured() || node.empty())
+        {
+            leaves_.insert(path);
+            return;
+        }
+
+        const size_t path_length = path.size();
+
+        // lambda, adds the child node, `key` is already escaped
+        auto add_child = [&](const nlohmann::json& child)
+        {
+            nodes_.insert(path);
+            add_children(child, add_children);
+            path.resize(path_length);
+        };
+
+        if (node.is_object())
+        {
+            for (const auto& item : node.items())
+            {
+                path += '/';
+
+                // escape the key like nlohmann::json::json_pointer does
+                for (const char c : item.key())
+                {
+                    if (c == '~')
+                        path += "~0";
+                    else if (c == '/')
+                        path += "~1";
+                    else
+                        path += c;
+                }
+
+                add_child(item.value());
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < node.size(); ++i)
+            {
+                path += '/';
+                path += std::to_string(i);
+                add_child(node[i]);
+            }
+        }
+    };
+
+    add_node(data, add_node);
+}
+
+bool
+ecb::YjKeyIndex::add(const std::string& key, const nlohmann::json& data,
+    std::vector<std::string>& new_nodes)
+{
+    const auto& value = data.at(nlohmann::json::json_pointer(key));
+
+    // the value has or had children, collect all keys again
+    if ((value.is_structured() && !value.empty()) || has_prefix(key + "/"))
+    {
+        *this = YjKeyIndex(data);
+        return false;
+    }
+
+    // add the key and its parents, e.g. "/a", "/a/b" and "/a/b/c"
+    for (size_t end = key.find('/', 1); ; end = key.find('/', end + 1))
+    {
+        std::string node = key.substr(0, end);
+
+        if (nodes_.insert(node).second)
+            new_nodes.push_back(node);
+
+        if (end == std::string::npos)
+            break;
+
+        // a parent can no longer be an empty list or object
+        leaves_.erase(node);
+    }
+
+    leaves_.insert(key);
+
+    return true;
+}
+
+void
+ecb::YjKeyIndex::remove(const std::string& key)
+{
+    leaves_.erase(key);
+    nodes_.erase(key);
+
+    // remove the parents from the bottom up, until a parent has other children
+    for (size_t end = key.rfind('/'); (end != std::string::npos) && (end != 0);
+        end = key.rfind('/', end - 1))
+    {
+        const std::string node = key.substr(0, end);
+
+        if (has_prefix(node + "/"))
+            break;
+
+        nodes_.erase(node);
+    }
+}
+
+bool
+ecb::YjKeyIndex::contains(const std::string& key) const
+{
+    return (nodes_.count(key) != 0) || (leaves_.count(key) != 0);
+}
+
+bool
+ecb::YjKeyIndex::is_leaf(const std::string& key) const
+{
+    return (leaves_.count(key) != 0);
+}
+
+bool
+ecb::YjKeyIndex::has_prefix(const std::string& prefix) const
+{
+    // keys starting with `prefix` follow directly after `prefix` in the
+    // sorted keys
+    const auto it = leaves_.lower_bound(prefix);
+
+    return (it != leaves_.end()) && (it->compare(0, prefix.size(), prefix) == 0);
+}
+
+const std::unordered_set<std::string>&
+ecb::YjKeyIndex::get_nodes() const
+{
+    return nodes_;
+}
+
+const std::set<std::string>&
+ecb::YjKeyIndex::get_leaves() const
+{
+    return leaves_;
+}
@@ -0,0 +1,94 @@
+//
+// ECB - sorted index of the keys of a configuration
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _YJ_KEY_INDEX_H_
+#define _YJ_KEY_INDEX_H_
+
+#include <nlohmann/json.hpp>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace ecb
+{
+// Keys of a configuration as JSON pointers, e.g. "/axis/id". The index is
+// built by one walk through the configuration and can be kept up to date
+// while values are added or removed, so the configuration doesn't have to be
+// flattened again. Prefix queries take O(log n).
+class YjKeyIndex
+{
+public:
+
+    YjKeyIndex() = default;
+
+    // Collects the keys of `data`.
+    explicit YjKeyIndex(
+        const nlohmann::json& data);
+
+
+    // Adds `key` (format "/a/b/c") and its parents after the value of `key`
+    // was set in `data`. Keys that were not in the index before are
+    // appended to `new_nodes`. If the value has or had children, the index
+    // is built again from `data` and false is returned, `new_nodes` is
+    // unchanged in this case.
+    bool add(
+        const std::string& key,
+        const nlohmann::json& data,
+        std::vector<std::string>& new_nodes);
+
+
+    // Removes the value without children `key` and all parents that have
+    // no other children, like `nlohmann::json::unflatten()` would do.
+    void remove(
+        const std::string& key);
+
+
+    // Returns true if `key` is a value in the configuration, with or
+    // without children.
+    bool contains(
+        const std::string& key) const;
+
+
+    // Returns true if `key` is a value without children, i.e. `key` is
+    // returned by `nlohmann::json::flatten()`.
+    bool is_leaf(
+        const std::string& key) const;
+
+
+    // Returns true if a value without children starts with `prefix`, e.g.
+    // "/drive/" is true if anything is defined below "/drive".
+    bool has_prefix(
+        const std::string& prefix) const;
+
+
+    // JSON pointers of all values, except the configuration itself
+    const std::unordered_set<std::string>& get_nodes() const;
+
+
+    // JSON pointers of all values without children, sorted like the keys
+    // returned by `nlohmann::json::flatten()`
+    const std::set<std::string>& get_leaves() const;
+
+private:
+    std::unordered_set<std::string> nodes_;
+    std::set<std::string> leaves_;
+};
+}
+
+#endif // _YJ_KEY_INDEX_H_
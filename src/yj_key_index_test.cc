@@ -0,0 +1,103 @@
+//
+// ECB - tests for yj_key_index module
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+#include "nlohmann/json.hpp"
+
+#include "yj_key_index.h"
+
+using nlohmann::json;
+using namespace ecb;
+
+class YjKeyIndexFixture : public testing::Test
+{
+protected:
+
+    YjKeyIndexFixture()
+    {
+        j1 = json::parse(R"(
+            {
+              "axis": {"id": 1, "a/b": "x", "list": [1, {"c": 2}], "empty": []},
+              "drive": {"type": "x"}
+            })");
+    }
+
+    json j1;
+};
+
+TEST_F(YjKeyIndexFixture, sameKeysAsFlatten)
+{
+    YjKeyIndex dut1(j1);
+
+    std::vector<std::string> dut2(dut1.get_leaves().begin(), dut1.get_leaves().end());
+    std::vector<std::string> dut3;
+    const json flat = j1.flatten();
+
+    for (const auto& item : flat.items())
+        dut3.push_back(item.key());
+
+    EXPECT_TRUE(dut2 == dut3);
+    EXPECT_TRUE(dut1.get_nodes().size() == 10);
+
+    EXPECT_TRUE(dut1.contains("/axis"));
+    EXPECT_TRUE(dut1.contains("/axis/a~1b"));
+    EXPECT_TRUE(dut1.contains("/axis/list/1"));
+    EXPECT_FALSE(dut1.contains("/axis/x"));
+    EXPECT_TRUE(dut1.is_leaf("/axis/empty"));
+    EXPECT_FALSE(dut1.is_leaf("/axis/list"));
+
+    EXPECT_TRUE(dut1.has_prefix("/drive/"));
+    EXPECT_TRUE(dut1.has_prefix("/axis/list/1/"));
+    EXPECT_FALSE(dut1.has_prefix("/axis/empty/"));
+    EXPECT_FALSE(dut1.has_prefix("/encoder/"));
+}
+
+TEST_F(YjKeyIndexFixture, addAndRemove)
+{
+    YjKeyIndex dut1(j1);
+    std::vector<std::string> dut2;
+
+    // new value without children
+    j1["/encoder/type"_json_pointer] = 1;
+    EXPECT_TRUE(dut1.add("/encoder/type", j1, dut2));
+    EXPECT_TRUE(dut2 == std::vector<std::string>({"/encoder", "/encoder/type"}));
+    EXPECT_TRUE(dut1.has_prefix("/encoder/"));
+
+    // an empty list gets an element
+    dut2.clear();
+    j1["/axis/empty/0"_json_pointer] = 1;
+    EXPECT_TRUE(dut1.add("/axis/empty/0", j1, dut2));
+    EXPECT_TRUE(dut2 == std::vector<std::string>({"/axis/empty/0"}));
+    EXPECT_FALSE(dut1.is_leaf("/axis/empty"));
+
+    // a value with children, the index is built again
+    dut2.clear();
+    j1["/drive"_json_pointer] = json::parse(R"({"a": 1})");
+    EXPECT_FALSE(dut1.add("/drive", j1, dut2));
+    EXPECT_TRUE(dut2.empty());
+    EXPECT_TRUE(dut1.is_leaf("/drive/a"));
+    EXPECT_FALSE(dut1.contains("/drive/type"));
+
+    // the parents are removed with their last child
+    dut1.remove("/drive/a");
+    EXPECT_FALSE(dut1.contains("/drive"));
+    dut1.remove("/axis/list/1/c");
+    EXPECT_FALSE(dut1.contains("/axis/list/1"));
+    EXPECT_TRUE(dut1.contains("/axis/list"));
+    EXPECT_TRUE(dut1.contains("/axis"));
+}
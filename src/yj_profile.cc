@@ -0,0 +1,172 @@
+//
+// ECB - phase timing and operation counters of a build
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cstdio>
+
+#include "yj_profile.h"
+
+using nlohmann::json;
+
+// profile of the calling thread, see `yj_profile::record`
+static thread_local ecb::YjProfile* recorded_profile = nullptr;
+
+
+void
+ecb::YjProfile::add_phase(const std::string& name, double duration_us, size_t calls)
+{
+    auto it = std::find_if(phases_.begin(), phases_.end(),
+            [&name](const YjProfilePhase& phase) { return phase.name == name; });
+
+    if (it == phases_.end())
+        it = phases_.insert(phases_.end(), {name, 0, 0.0});
+
+    it->calls += calls;
+    it->duration_us += duration_us;
+}
+
+void
+ecb::YjProfile::add_count(const std::string& name, size_t count)
+{
+    auto it = std::find_if(counters_.begin(), counters_.end(),
+            [&name](const YjProfileCounter& counter) { return counter.name == name; });
+
+    if (it == counters_.end())
+        it = counters_.insert(counters_.end(), {name, 0});
+
+    it->count += count;
+}
+
+void
+ecb::YjProfile::merge(const YjProfile& profile)
+{
+    for (const auto& phase : profile.phases_)
+        add_phase(phase.name, phase.duration_us, phase.calls);
+
+    for (const auto& counter : profile.counters_)
+        add_count(counter.name, counter.count);
+}
+
+const std::vector<ecb::YjProfilePhase>&
+ecb::YjProfile::get_phases() const
+{
+    return phases_;
+}
+
+const std::vector<ecb::YjProfileCounter>&
+ecb::YjProfile::get_counters() const
+{
+    return counters_;
+}
+
+void
+ecb::YjProfile::set_wall_time(double duration_us)
+{
+    wall_time_us_ = duration_us;
+}
+
+std::string
+ecb::YjProfile::to_text() const
+{
+    std::string ret_val = "== ECB: PROFILE ================\n";
+    char line[128];
+    double total_us = 0.0;
+
+    for (const auto& phase : phases_)
+    {
+        std::snprintf(line, sizeof(line), "%-40s %8zu x %12.1f us\n", phase.name.c_str(), phase.calls,
+            phase.duration_us);
+        ret_val += line;
+        total_us += phase.duration_us;
+    }
+
+    std::snprintf(line, sizeof(line), "%-40s %23.1f us\n", "sum of phases", total_us);
+    ret_val += line;
+
+    if (wall_time_us_)
+    {
+        std::snprintf(line, sizeof(line), "%-40s %23.1f us\n", "wall time", *wall_time_us_);
+        ret_val += line;
+    }
+
+    for (const auto& counter : counters_)
+    {
+        std::snprintf(line, sizeof(line), "%-40s %8zu\n", counter.name.c_str(), counter.count);
+        ret_val += line;
+    }
+
+    return ret_val;
+}
+
+json
+ecb::YjProfile::to_json() const
+{
+    json ret_val;
+    ret_val["phases"] = json::array();
+    ret_val["counters"] = json::object();
+
+    for (const auto& phase : phases_)
+    {
+        ret_val["phases"].push_back({{"name", phase.name}, {"calls", phase.calls},
+            {"duration_us", phase.duration_us}});
+    }
+
+    for (const auto& counter : counters_)
+        ret_val["counters"][counter.name] = counter.count;
+
+    if (wall_time_us_)
+        ret_val["wall_time_us"] = *wall_time_us_;
+
+    return ret_val;
+}
+
+void
+ecb::yj_profile::record(YjProfile* profile)
+{
+    recorded_profile = profile;
+}
+
+ecb::YjProfile*
+ecb::yj_profile::get_profile()
+{
+    return recorded_profile;
+}
+
+void
+ecb::yj_profile::count(const char* name, size_t count)
+{
+    if (recorded_profile != nullptr)
+        recorded_profile->add_count(name, count);
+}
+
+ecb::YjProfileTimer::YjProfileTimer(const char* name)
+    : profile_(recorded_profile), name_(name)
+{
+    if (profile_ != nullptr)
+        start_ = std::chrono::steady_clock::now();
+}
+
+ecb::YjProfileTimer::~YjProfileTimer()
+{
+    if (profile_ != nullptr)
+    {
+        const std::chrono::duration<double, std::micro> duration =
+            std::chrono::steady_clock::now() - start_;
+        profile_->add_phase(name_, duration.count());
+    }
+}
@@ -0,0 +1,143 @@
+//
+// ECB - phase timing and operation counters of a build
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _YJ_PROFILE_H_
+#define _YJ_PROFILE_H_
+
+#include <chrono>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ecb
+{
+// Accumulated wall time of one phase, e.g. `schema.normalize`.
+struct YjProfilePhase
+{
+    std::string name;
+    size_t calls = 0;
+    double duration_us = 0.0;
+};
+
+
+// Accumulated value of one operation counter, e.g. `flatten_calls`.
+struct YjProfileCounter
+{
+    std::string name;
+    size_t count = 0;
+};
+
+
+// Phase timing and operation counters of one or more builds. A profile is
+// filled by `YjProfileTimer` and `yj_profile::count` while it is recorded
+// (see `yj_profile::record`).
+class YjProfile
+{
+public:
+
+    // Adds `duration_us` to the phase `name`. Phases and counters are kept
+    // in the order they were first added.
+    void add_phase(
+        const std::string& name,
+        double duration_us,
+        size_t calls = 1);
+
+
+    // Adds `count` to the counter `name`.
+    void add_count(
+        const std::string& name,
+        size_t count);
+
+
+    // Adds all phases and counters of `profile` to this profile.
+    void merge(
+        const YjProfile& profile);
+
+
+    const std::vector<YjProfilePhase>& get_phases() const;
+    const std::vector<YjProfileCounter>& get_counters() const;
+
+
+    // Sets the measured wall time of the whole run. It is not the sum of
+    // the phases: phases can be nested (e.g. `output.write` in
+    // `template.render`) and the threads of `buildmany` run in parallel.
+    // `merge` does not add it.
+    void set_wall_time(
+        double duration_us);
+
+
+    // Returns the profile as table for humans, one line per phase or
+    // counter, followed by the sum of all phases and the wall time, if it
+    // was set.
+    std::string to_text() const;
+
+
+    // Returns the profile as JSON object with the list `phases`, the object
+    // `counters` with the count of each counter, and `wall_time_us`, if the
+    // wall time was set.
+    nlohmann::json to_json() const;
+
+private:
+    std::vector<YjProfilePhase> phases_;
+    std::vector<YjProfileCounter> counters_;
+    std::optional<double> wall_time_us_;
+};
+
+
+namespace yj_profile
+{
+
+// Records the phases and counters of the calling thread in `profile`.
+// Passing nullptr stops the recording, which is the default.
+void record(
+    YjProfile* profile);
+
+// Returns the profile recorded by the calling thread, or nullptr.
+YjProfile* get_profile();
+
+// Adds `count` to the counter `name` of the recorded profile. Does nothing
+// if the calling thread records no profile.
+void count(
+    const char* name,
+    size_t count = 1);
+}
+
+
+// Measures the wall time from its construction to its destruction and adds
+// it as phase `name` to the profile recorded by the calling thread. If no
+// profile is recorded, the clock is not read at all.
+class YjProfileTimer
+{
+public:
+    explicit YjProfileTimer(
+        const char* name);
+
+    ~YjProfileTimer();
+
+    YjProfileTimer(const YjProfileTimer&) = delete;
+    YjProfileTimer& operator=(const YjProfileTimer&) = delete;
+
+private:
+    YjProfile* profile_;
+    const char* name_;
+    std::chrono::steady_clock::time_point start_;
+};
+}
+
+#endif // _YJ_PROFILE_H_
@@ -0,0 +1,122 @@
+//
+// ECB - tests for yj_profile module
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+#include "nlohmann/json.hpp"
+
+#include "yj_profile.h"
+
+using nlohmann::json;
+using namespace ecb;
+
+class YjProfileFixture : public testing::Test
+{
+protected:
+
+    YjProfileFixture()
+    {
+        j1 = json();
+    }
+
+    ~YjProfileFixture()
+    {
+        yj_profile::record(nullptr);
+    }
+
+    json j1;
+};
+
+TEST_F(YjProfileFixture, record)
+{
+    YjProfile dut1;
+
+    // nothing is recorded without a profile
+    {
+        YjProfileTimer timer("a");
+        yj_profile::count("x");
+    }
+
+    EXPECT_TRUE(yj_profile::get_profile() == nullptr);
+
+    yj_profile::record(&dut1);
+    EXPECT_TRUE(yj_profile::get_profile() == &dut1);
+
+    {
+        YjProfileTimer timer("b");
+        yj_profile::count("x", 2);
+    }
+
+    {
+        YjProfileTimer timer("a");
+        yj_profile::count("y");
+        yj_profile::count("x");
+    }
+
+    {
+        YjProfileTimer timer("b");
+    }
+
+    yj_profile::record(nullptr);
+    yj_profile::count("x");
+
+    // in the order they were first added
+    const auto& dut2 = dut1.get_phases();
+    ASSERT_EQ(dut2.size(), 2);
+    EXPECT_TRUE((dut2[0].name == "b") && (dut2[0].calls == 2));
+    EXPECT_TRUE((dut2[1].name == "a") && (dut2[1].calls == 1));
+    EXPECT_TRUE(dut2[0].duration_us >= 0.0);
+
+    const auto& dut3 = dut1.get_counters();
+    ASSERT_EQ(dut3.size(), 2);
+    EXPECT_TRUE((dut3[0].name == "x") && (dut3[0].count == 3));
+    EXPECT_TRUE((dut3[1].name == "y") && (dut3[1].count == 1));
+}
+
+TEST_F(YjProfileFixture, mergeAndOutput)
+{
+    YjProfile dut1;
+    YjProfile dut2;
+
+    dut1.add_phase("yaml.read", 10.0);
+    dut1.add_count("flatten_calls", 1);
+    dut2.add_phase("schema.normalize", 5.0, 2);
+    dut2.add_phase("yaml.read", 20.0);
+    dut2.add_count("flatten_calls", 2);
+    dut1.merge(dut2);
+
+    j1 = dut1.to_json();
+    ASSERT_EQ(j1["phases"].size(), 2);
+    EXPECT_TRUE(j1["phases"][0]["name"] == "yaml.read");
+    EXPECT_TRUE(j1["phases"][0]["calls"] == 2);
+    EXPECT_TRUE(j1["phases"][0]["duration_us"] == 30.0);
+    EXPECT_TRUE(j1["phases"][1]["name"] == "schema.normalize");
+    EXPECT_TRUE(j1["phases"][1]["calls"] == 2);
+    EXPECT_TRUE(j1["counters"]["flatten_calls"] == 3);
+
+    const std::string dut3 = dut1.to_text();
+    EXPECT_TRUE(dut3.find("yaml.read") < dut3.find("schema.normalize"));
+    EXPECT_TRUE(dut3.find("35.0 us") != std::string::npos);
+    EXPECT_TRUE(dut3.find("flatten_calls") != std::string::npos);
+    EXPECT_TRUE(dut3.find("wall time") == std::string::npos);
+    EXPECT_FALSE(j1.contains("wall_time_us"));
+
+    // the wall time is measured, not the sum of the phases
+    dut1.set_wall_time(12.0);
+    EXPECT_TRUE(dut1.to_json()["wall_time_us"] == 12.0);
+    EXPECT_TRUE(dut1.to_text().find("12.0 us") != std::string::npos);
+}
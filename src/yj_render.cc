@@ -16,28 +16,226 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
 #include <inja.hpp>
 #include <iostream>
 #include <iterator>
-#include <regex>
+#include <sstream>
+#include <streambuf>
+#include <thread>
 
 #include "yj_common.h"
+#include "yj_file.h"
+#include "yj_profile.h"
 #include "yj_render.h"
 
 using namespace inja;
 using nlohmann::json;
 
+// identifies the ECB build that wrote an entry of the on-disk template cache
+#define ECB_TEMPLATE_CACHE_VERSION (MAKEFILE_BUILD_VERSION "-" MAKEFILE_BUILD_HASH MAKEFILE_BUILD_DIRTY \
+    "-" MAKEFILE_BUILD_DATE)
+
+// keys of the data of the template that is rendered by the current thread,
+// used by the callback `isDefined`
+static thread_local const ecb::YjKeyIndex* cfg_keys_ = nullptr;
+
+
+// callback `isDefined("a.b")`, true if the key exists, incomplete keys
+// like "a" match as well
+static nlohmann::json
+is_defined(inja::Arguments& args)
+{
+    if ((cfg_keys_ == nullptr) || !args[0]->is_string())
+        return false;
+
+    std::string key = "/" + args[0]->get<std::string>();
+    std::replace(key.begin(), key.end(), '.', '/');
+
+    return cfg_keys_->has_prefix(key);
+}
+
+// callback `toInt(X)`, booleans are converted to 1 or 0, all other values
+// are returned unchanged
+static nlohmann::json
+to_int(inja::Arguments& args)
+{
+    if (args[0]->is_boolean())
+        return (args[0]->get<bool>() == true) ? 1 : 0;
+
+    return *args[0];
+}
+
+// callback `toFloat(X)`, numbers are converted to floats rounded to six
+// decimal places, all other values are returned unchanged
+static nlohmann::json
+to_float(inja::Arguments& args)
+{
+    if (args[0]->is_number())
+        return std::stod(std::to_string(args[0]->get<double>()));
+
+    return *args[0];
+}
+
+// appends `value` to `values` if it is not contained yet
+static void
+add_unique(std::vector<std::string>& values, const std::string& value)
+{
+    if (std::find(values.cbegin(), values.cend(), value) == values.cend())
+        values.push_back(value);
+}
+
+// appends the file state `dependency` to `dependencies` if the file is not
+// contained yet
+static void
+add_unique_dependency(std::vector<json>& dependencies, const json& dependency)
+{
+    for (const auto& existing : dependencies)
+    {
+        if (existing == dependency)
+            return;
+    }
+
+    dependencies.push_back(dependency);
+}
+
+// true if none of the files in `dependencies` has changed since it was read,
+// see `yj_common::is_file_unchanged`
+static bool
+are_files_unchanged(const std::vector<json>& dependencies)
+{
+    for (const auto& dependency : dependencies)
+    {
+        if (dependency.is_null() || !ecb::yj_common::is_file_unchanged(dependency))
+            return false;
+    }
+
+    return true;
+}
+
+// throws an exception if `file` has more nested includes than allowed
+static void
+check_include_depth(const ecb::YjPreprocessedFile& file)
+{
+    if (file.levels > ECMC_YJ_RENDER_MAX_INCLUDE_DEPTH)
+        throw std::runtime_error("template: limit of nested includes is exceed. Limit: ECMC_YJ_RENDER_MAX_INCLUDE_DEPTH");
+}
+
+// Stream buffer that forwards everything to `destination` except a newline
+// at the very end: a newline is held back until more characters follow.
+class YjTrimNewlineBuffer : public std::streambuf
+{
+public:
+    explicit YjTrimNewlineBuffer(std::streambuf* destination)
+        : destination_(destination)
+    {
+    }
+
+protected:
+    int_type
+    overflow(int_type c) override
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+
+        char ch = traits_type::to_char_type(c);
+        return (xsputn(&ch, 1) == 1) ? c : traits_type::eof();
+    }
+
+    std::streamsize
+    xsputn(const char* s, std::streamsize n) override
+    {
+        if (n <= 0)
+            return 0;
+
+        if (pending_newline_ && (destination_->sputc('\n') == traits_type::eof()))
+            return 0;
+
+        pending_newline_ = (s[n - 1] == '\n');
+        const std::streamsize count = pending_newline_ ? n - 1 : n;
+
+        return (destination_->sputn(s, count) == count) ? n : 0;
+    }
+
+    int
+    sync() override
+    {
+        return destination_->pubsync();
+    }
+
+private:
+    std::streambuf* destination_;
+    bool pending_newline_ = false;
+};
+
+ecb::YjRender::YjRender()
+{
+    env_ = std::make_shared<inja::Environment>();
+    env_->set_trim_blocks(true);
+    env_->add_callback("isDefined", 1, is_defined);
+    env_->add_callback("toInt", 1, to_int);
+    env_->add_callback("toFloat", 1, to_float);
+    template_files_mutex_ = std::make_shared<std::mutex>();
+}
 
 std::string
 ecb::YjRender::render(
     const std::string& filename, const std::string& template_dir, json& data)
 {
-    std::ifstream template_content(filename);
+    return render(filename, template_dir, data, YjKeyIndex(data));
+}
 
-    if (!template_content)
-        throw std::runtime_error("template file not found: " + filename);
+std::string
+ecb::YjRender::render(
+    const std::string& filename, const std::string& template_dir, json& data,
+    const YjKeyIndex& keys)
+{
+    std::ostringstream output;
 
-    return render(template_content, template_dir, data);
+    if (!render(filename, template_dir, data, keys, output))
+        return {};
+
+    return output.str();
+}
+
+bool
+ecb::YjRender::render(
+    const std::string& filename, const std::string& template_dir, json& data,
+    const YjKeyIndex& keys, std::ostream& output)
+{
+    std::vector<json> dependencies;
+
+    return render(filename, template_dir, data, keys, output, dependencies);
+}
+
+bool
+ecb::YjRender::render(
+    const std::string& filename, const std::string& template_dir, json& data,
+    const YjKeyIndex& keys, std::ostream& output, std::vector<json>& dependencies)
+{
+    const auto preprocessed_template = get_preprocessed_template(filename, template_dir);
+    dependencies.insert(dependencies.end(), preprocessed_template->dependencies.cbegin(),
+        preprocessed_template->dependencies.cend());
+    std::shared_ptr<const inja::Template> parsed;
+
+    {
+        std::lock_guard<std::mutex> lock(*template_files_mutex_);
+        parsed = preprocessed_template->parsed;
+        (parsed != nullptr) ? ++template_cache_stats_.hits : ++template_cache_stats_.misses;
+    }
+
+    const bool ret_val = render_preprocessed(preprocessed_template->content, parsed, data, keys,
+            output);
+
+    std::lock_guard<std::mutex> lock(*template_files_mutex_);
+
+    if (preprocessed_template->parsed == nullptr)
+        preprocessed_template->parsed = parsed;
+
+    return ret_val;
 }
 
 std::string
@@ -46,23 +244,353 @@ ecb::YjRender::render(
     nlohmann::json& data)
 {
     std::string line;
-    std::string preprocessed_template;
-    std::map<std::string, nlohmann::json> flatten_data = data.flatten();
+    YjPreprocessedFile preprocessed_template;
+    std::vector<std::string> include_stack;
+    std::shared_ptr<const inja::Template> parsed;
 
     while (std::getline(template_content, line))
-        preprocess_line(line, preprocessed_template, template_dir, flatten_data, 1);
+        preprocess_line(line, preprocessed_template, template_dir, include_stack);
+
+    check_include_depth(preprocessed_template);
+    std::ostringstream output;
+
+    if (!render_preprocessed(preprocessed_template.content, parsed, data, YjKeyIndex(data),
+            output))
+        return {};
+
+    return output.str();
+}
+
+std::string
+ecb::YjRender::preprocess(const std::string& filename, const std::string& template_dir)
+{
+    return get_preprocessed_template(filename, template_dir)->content;
+}
+
+std::vector<std::string>
+ecb::YjRender::get_includes(const std::string& filename, const std::string& template_dir)
+{
+    return get_preprocessed_template(filename, template_dir)->includes;
+}
+
+std::map<std::string, std::vector<std::string>>
+ecb::YjRender::get_include_graph(const std::string& filename, const std::string& template_dir)
+{
+    std::map<std::string, std::vector<std::string>> ret_val;
+    std::vector<std::string> pending = {filename};
+    std::vector<std::string> include_stack;
+
+    while (!pending.empty())
+    {
+        const std::string file = pending.back();
+        pending.pop_back();
+
+        if (ret_val.count(file) != 0)
+            continue;
+
+        const auto preprocessed_file = get_preprocessed_file(file, template_dir, include_stack);
+
+        if (preprocessed_file == nullptr)
+            throw std::runtime_error("template file not found: " + file);
+
+        ret_val[file] = preprocessed_file->includes;
+        pending.insert(pending.end(), preprocessed_file->includes.cbegin(),
+            preprocessed_file->includes.cend());
+    }
+
+    return ret_val;
+}
+
+ecb::YjTemplateCacheStats
+ecb::YjRender::get_template_cache_stats()
+{
+    std::lock_guard<std::mutex> lock(*template_files_mutex_);
+    return template_cache_stats_;
+}
+
+std::shared_ptr<ecb::YjPreprocessedTemplate>
+ecb::YjRender::get_preprocessed_template(
+    const std::string& filename, const std::string& template_dir)
+{
+    const auto key = std::make_pair(filename, template_dir);
+    std::shared_ptr<YjPreprocessedTemplate> cached_template;
+
+    {
+        std::lock_guard<std::mutex> lock(*template_files_mutex_);
+
+        if (auto it = templates_.find(key); it != templates_.end())
+            cached_template = it->second;
+    }
+
+    if (cached_template != nullptr)
+    {
+        if (are_files_unchanged(cached_template->dependencies))
+            return cached_template;
+
+        std::lock_guard<std::mutex> lock(*template_files_mutex_);
+
+        if (auto it = templates_.find(key);
+            (it != templates_.end()) && (it->second == cached_template))
+            templates_.erase(it);
+    }
+
+    YjProfileTimer timer("template.preprocess");
+    std::shared_ptr<YjPreprocessedTemplate> preprocessed_template;
+
+    if (!cache_dir_.empty())
+        preprocessed_template = read_cached_template(filename, template_dir);
+
+    if (preprocessed_template == nullptr)
+    {
+        std::vector<std::string> include_stack;
+        const auto preprocessed_file = get_preprocessed_file(filename, template_dir,
+                include_stack);
+
+        if (preprocessed_file == nullptr)
+            throw std::runtime_error("template file not found: " + filename);
+
+        check_include_depth(*preprocessed_file);
+
+        preprocessed_template = std::make_shared<YjPreprocessedTemplate>();
+        preprocessed_template->content = preprocessed_file->content;
+        preprocessed_template->includes = preprocessed_file->closure;
+        preprocessed_template->dependencies = preprocessed_file->dependencies;
+
+        if (!cache_dir_.empty())
+            write_cached_template(filename, template_dir, *preprocessed_template);
+    }
+
+    // another thread may have preprocessed the same template in the meantime
+    std::lock_guard<std::mutex> lock(*template_files_mutex_);
+    return templates_.emplace(key, std::move(preprocessed_template)).first->second;
+}
+
+std::shared_ptr<const ecb::YjPreprocessedFile>
+ecb::YjRender::get_preprocessed_file(
+    const std::string& filename, const std::string& template_dir,
+    std::vector<std::string>& include_stack)
+{
+    const auto key = std::make_pair(filename, template_dir);
+    std::shared_ptr<const YjPreprocessedFile> cached_file;
+
+    {
+        std::lock_guard<std::mutex> lock(*template_files_mutex_);
+
+        if (auto it = preprocessed_files_.find(key); it != preprocessed_files_.end())
+            cached_file = it->second;
+    }
+
+    if (cached_file != nullptr)
+    {
+        if (are_files_unchanged(cached_file->dependencies))
+            return cached_file;
+
+        std::lock_guard<std::mutex> lock(*template_files_mutex_);
+
+        if (auto it = preprocessed_files_.find(key);
+            (it != preprocessed_files_.end()) && (it->second == cached_file))
+            preprocessed_files_.erase(it);
+    }
+
+    if (auto it = std::find(include_stack.cbegin(), include_stack.cend(), filename);
+        it != include_stack.cend())
+    {
+        std::string cycle;
+
+        for (; it != include_stack.cend(); ++it)
+            cycle += *it + " -> ";
+
+        throw std::runtime_error("template: cyclic include: " + cycle + filename);
+    }
+
+    const auto template_file = read_template_file(filename);
+
+    if (template_file == nullptr)
+        return nullptr;
+
+    auto ret_val = std::make_shared<YjPreprocessedFile>();
+    ret_val->dependencies.push_back(template_file->file_state);
+    include_stack.push_back(filename);
+
+    for (std::string line : template_file->lines)
+        preprocess_line(line, *ret_val, template_dir, include_stack);
+
+    include_stack.pop_back();
+
+    // another thread may have preprocessed the same file in the meantime
+    std::lock_guard<std::mutex> lock(*template_files_mutex_);
+    return preprocessed_files_.emplace(key, std::move(ret_val)).first->second;
+}
+
+void
+ecb::YjRender::set_cache_dir(const std::string& cache_dir)
+{
+    cache_dir_ = cache_dir;
+}
+
+std::string
+ecb::YjRender::get_cache_filename(
+    const std::string& filename, const std::string& template_dir)
+{
+    return cache_dir_ + "/" + yj_common::hash(filename + '\n' + template_dir) + ".json";
+}
+
+std::shared_ptr<ecb::YjPreprocessedTemplate>
+ecb::YjRender::read_cached_template(
+    const std::string& filename, const std::string& template_dir)
+{
+    YjFile cache_file(get_cache_filename(filename, template_dir));
 
-    std::string rendered_template = {};
+    if (!cache_file.is_open())
+        return nullptr;
+
+    const auto cache_content = cache_file.get_content();
+    const auto entry = nlohmann::json::parse(cache_content.begin(), cache_content.end(), nullptr, false);
+
+    try
+    {
+        if ((entry.at("ecb") != ECB_TEMPLATE_CACHE_VERSION) || (entry.at("template") != filename)
+            || (entry.at("templateDir") != template_dir))
+            return nullptr;
+
+        for (const auto& dependency : entry.at("dependencies"))
+        {
+            if (!yj_common::is_file_unchanged(dependency))
+                return nullptr;
+        }
+
+        auto ret_val = std::make_shared<YjPreprocessedTemplate>();
+        ret_val->content = entry.at("content");
+        ret_val->includes = entry.at("includes").get<std::vector<std::string>>();
+        ret_val->dependencies = entry.at("dependencies").get<std::vector<nlohmann::json>>();
+
+        return ret_val;
+    }
+    catch (const nlohmann::json::exception&)
+    {
+        // damaged or incompatible entry
+        return nullptr;
+    }
+}
+
+void
+ecb::YjRender::write_cached_template(
+    const std::string& filename, const std::string& template_dir,
+    const YjPreprocessedTemplate& preprocessed_template)
+{
+    nlohmann::json entry;
+    entry["ecb"] = ECB_TEMPLATE_CACHE_VERSION;
+    entry["template"] = filename;
+    entry["templateDir"] = template_dir;
+    entry["includes"] = preprocessed_template.includes;
+    entry["dependencies"] = nlohmann::json::array();
+
+    for (const auto& dependency : preprocessed_template.dependencies)
+    {
+        if (dependency.is_null())
+            return;
+
+        entry["dependencies"].push_back(dependency);
+    }
+
+    entry["content"] = preprocessed_template.content;
+
+    // write to a temporary file first, so that other processes never read
+    // an incomplete entry
+    const std::string cache_filename = get_cache_filename(filename, template_dir);
+    const std::string temp_filename = cache_filename + "."
+        + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    std::error_code error;
+
+    std::filesystem::create_directories(cache_dir_, error);
+
+    {
+        std::ofstream cache_file(temp_filename, std::ios::binary);
+
+        if (!cache_file)
+            return;
+
+        cache_file << entry.dump();
+
+        if (!cache_file)
+        {
+            cache_file.close();
+            std::filesystem::remove(temp_filename, error);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temp_filename, cache_filename, error);
+
+    if (error)
+        std::filesystem::remove(temp_filename, error);
+}
+
+std::shared_ptr<const ecb::YjTemplateFile>
+ecb::YjRender::read_template_file(const std::string& filename)
+{
+    std::shared_ptr<const YjTemplateFile> cached_file;
+
+    {
+        std::lock_guard<std::mutex> lock(*template_files_mutex_);
+
+        if (auto it = template_files_.find(filename); it != template_files_.end())
+            cached_file = it->second;
+    }
+
+    if (cached_file != nullptr)
+    {
+        if (are_files_unchanged({cached_file->file_state}))
+            return cached_file;
+
+        std::lock_guard<std::mutex> lock(*template_files_mutex_);
+
+        if (auto it = template_files_.find(filename);
+            (it != template_files_.end()) && (it->second == cached_file))
+            template_files_.erase(it);
+    }
+
+    // the file is read without holding the lock, so other threads can use
+    // the cached files in the meantime
+    YjFile template_file(filename);
+
+    if (!template_file.is_open())
+        return nullptr;
+
+    auto ret_val = std::make_shared<YjTemplateFile>();
+    ret_val->file_state = yj_common::get_file_state(template_file);
+    ret_val->lines = template_file.get_lines();
+
+    // another thread may have read the same file in the meantime
+    std::lock_guard<std::mutex> lock(*template_files_mutex_);
+    return template_files_.emplace(filename, std::move(ret_val)).first->second;
+}
+
+bool
+ecb::YjRender::render_preprocessed(
+    const std::string& preprocessed_template, std::shared_ptr<const inja::Template>& parsed,
+    nlohmann::json& data, const YjKeyIndex& keys, std::ostream& output)
+{
+    YjTrimNewlineBuffer trimmed_buffer(output.rdbuf());
+    std::ostream trimmed_output(&trimmed_buffer);
+    cfg_keys_ = &keys;
 
     try
     {
-        inja::Environment env;
-        env.set_trim_blocks(true);
-        rendered_template = env.render(preprocessed_template, data);
+        if (parsed == nullptr)
+        {
+            YjProfileTimer timer("template.parse");
+            parsed = std::make_shared<const inja::Template>(env_->parse(preprocessed_template));
+        }
+
+        YjProfileTimer timer("template.render");
+        env_->render_to(trimmed_output, *parsed, data);
     }
     catch (const json::exception& e)
     {
-        std::cout << e.what() << '\n';
+        yj_common::log_stream() << e.what() << '\n';
+        cfg_keys_ = nullptr;
+        return false;
     }
     catch (const inja::InjaError&  e)
     {
@@ -71,11 +599,11 @@ ecb::YjRender::render(
         size_t stop_index = 0;
         bool found_start = false;
 
-        std::cout << "== ECB: YAML ===================" << std::endl;
-        std::cout << data.dump(2) << std::endl;
+        yj_common::log_stream() << "== ECB: YAML ===================" << std::endl;
+        yj_common::log_stream() << data.dump(2) << std::endl;
 
-        std::cout << "== ECB: INJA ===================" << std::endl;
-        std::cout << e.what() << std::endl;
+        yj_common::log_stream() << "== ECB: INJA ===================" << std::endl;
+        yj_common::log_stream() << e.what() << std::endl;
 
         for (size_t i = 0 ; i < preprocessed_template.length() ; ++i)
         {
@@ -97,242 +625,343 @@ ecb::YjRender::render(
             }
         }
 
-        std::cout << std::endl << preprocessed_template.substr(start_index,
+        yj_common::log_stream() << std::endl << preprocessed_template.substr(start_index,
                 (stop_index - start_index)) << std::endl;
+        cfg_keys_ = nullptr;
         throw e;
     }
 
-    // remove last newline if it exists
-    if (!rendered_template.empty() && rendered_template[rendered_template.length() - 1] == '\n')
-        rendered_template.erase(rendered_template.length() - 1);
+    cfg_keys_ = nullptr;
 
-    return rendered_template;
+    if (!trimmed_output)
+        output.setstate(std::ios::badbit);
+
+    return true;
 }
 
 
-void
-ecb::YjRender::transform_is_defined(
-    std::string& line, const std::map<std::string, nlohmann::json>& data)
+// true for the characters of a key, the same as `[\w.]`
+static bool
+is_key_char(char c)
 {
+    return std::isalnum(static_cast<unsigned char>(c)) || (c == '_') || (c == '.');
+}
 
-start:
-    auto split = ecb::yj_common::tokenize(line, ecb::yj_common::REGEX_token_sep_space);
+// true for whitespaces, the same as `\s`
+static bool
+is_space(char c)
+{
+    return std::isspace(static_cast<unsigned char>(c));
+}
 
-    const auto REGEX_convert_to_key = std::regex(R"(^\(|^|\.)");
-    bool is_defined = false;
-    bool is_existing_key = false;
+// true for characters that do not match `.`
+static bool
+is_line_terminator(char c)
+{
+    return (c == '\n') || (c == '\r');
+}
 
-    auto iter  = std::find(split.begin(), split.end(), "is");
-    auto iter_p1 = std::next(iter, 1); // iter plus one
-    auto iter_p2 = std::next(iter, 2); // iter plus two
+// returns the position of the first character after `pos` for which
+// `is_char` is false
+static size_t
+skip_chars(const std::string& line, size_t pos, bool (*is_char)(char))
+{
+    while ((pos < line.length()) && is_char(line[pos]))
+        ++pos;
 
-    if ((iter != split.cend()) && (iter_p2 != split.cend()))
-    {
-        if ((iter_p1->compare("defined") == 0) || iter_p1->compare("defined)") == 0)
-        {
-            is_defined = true;
-            goto found;
-        }
+    return pos;
+}
 
-        if ((iter_p1->compare("not") == 0) && ((iter_p2->compare("defined") == 0)
-                || (iter_p2->compare("defined)") == 0)))
-            goto found;
-    }
+// true if `word` starts at `pos` and is not followed by a key character
+static bool
+is_word_at(const std::string& line, size_t pos, const char* word)
+{
+    const size_t length = std::strlen(word);
 
-    return;
+    return (line.compare(pos, length, word) == 0)
+        && ((pos + length == line.length()) || !is_key_char(line[pos + length]));
+}
 
-found:
-    auto iter_m1 = std::prev(iter); // iter minus one
-    const std::string found_key = std::regex_replace(*iter_m1, REGEX_convert_to_key, "/");
+// Returns the position after the string literal that starts at `pos`. A
+// backslash escapes the next character, an unterminated literal ends at the
+// end of the line.
+static size_t
+skip_string(const std::string& line, size_t pos)
+{
+    const char quote = line[pos];
 
-    // check if key exists, match also incomplete keys
-    for (const auto& entry : data)
+    for (++pos; pos < line.length(); ++pos)
     {
-        if ((entry.first.rfind(found_key, 0) == 0) || (entry.first == (found_key + "/0")))
-        {
-            is_existing_key = true;
-            break;
-        }
+        if (line[pos] == '\\')
+            ++pos;
+        else if (line[pos] == quote)
+            return pos + 1;
     }
 
-    if (is_defined == is_existing_key)
-        *iter_m1 = "true";
-    else
-        *iter_m1 = "false";
+    return line.length();
+}
 
-    auto iter_end = iter_p2;
+// Returns the position of the parenthesis that closes the one before `pos`,
+// or std::string::npos if it is not closed in `line`. Parentheses in string
+// literals are ignored.
+static size_t
+find_closing_parenthesis(const std::string& line, size_t pos)
+{
+    size_t depth = 1;
 
-    if (!is_defined)
-        ++iter_end;
+    while (pos < line.length())
+    {
+        const char c = line[pos];
 
-    split.erase(iter, iter_end);
+        if ((c == '"') || (c == '\''))
+        {
+            pos = skip_string(line, pos);
+            continue;
+        }
 
-    line = {};
+        if ((c == ')') && (--depth == 0))
+            return pos;
 
-    for (auto it = split.cbegin() ; it != split.cend(); ++it)
-    {
-        line += *it;
+        if (c == '(')
+            ++depth;
 
-        if ((it + 1) != split.cend())
-            line += " ";
+        ++pos;
     }
 
-    goto start;
+    return std::string::npos;
 }
 
-void
-ecb::YjRender::transform_is_string(std::string& line)
+// Returns the default value X of `K|default(X)|float` as float, 0 if X is
+// not a number.
+static std::string
+to_float_default(const std::string& value)
 {
-    const auto REGEX_find_is_string = std::regex(R"(([\w.]+)\s+(?=(is\s+string)))");
-    const auto REGEX_replace_is_string = std::regex(R"(([\w.]+\s+is\s+string))");
+    double ret_val = 0.0;
+
+    try
+    {
+        ret_val = std::stod(value);
+    }
+    catch (...)
+    {
+        ecb::yj_common::log_stream() << "transform_expressions: cannot cast string to double"
+            << std::endl;
+    }
 
-    for (std::smatch match ; std::regex_search(line, match, REGEX_find_is_string);)
-        line = std::regex_replace(line, REGEX_replace_is_string,
-                ("isString(" + match[1].str() + ")"), std::regex_constants::format_first_only);
+    return std::to_string(ret_val);
 }
 
-void
-ecb::YjRender::transform_loop_index0(std::string& line)
+// Rewrites the test `K is defined`, `K is not defined` or `K is string` that
+// follows the key K in `expression` at `pos`. Returns the position after the
+// test, or `pos` if no test follows.
+static size_t
+transform_test(const std::string& line, size_t pos, std::string& expression)
 {
-    const auto REGEX_loop_index0 = std::regex(R"(loop.index0)");
+    size_t next = skip_chars(line, pos, is_space);
 
-    for (std::smatch match ; std::regex_search(line, match, REGEX_loop_index0);)
-        line = std::regex_replace(line, REGEX_loop_index0, "loop.index",
-                std::regex_constants::format_first_only);
-}
+    if ((next == pos) || !is_word_at(line, next, "is"))
+        return pos;
 
-void
-ecb::YjRender::transform_default(std::string& line)
-{
-    const auto REGEX_find_default_pipe = std::regex(R"(([\w.]+)(?=\|default\((.+?)\)))");
-    const auto REGEX_replace_default_pipe = std::regex(R"([\w.]+\|default\(.+?\))");
+    size_t word = skip_chars(line, next + 2, is_space);
+    bool is_negated = false;
 
-    for (std::smatch match ; std::regex_search(line, match, REGEX_find_default_pipe);)
+    if ((word > next + 2) && is_word_at(line, word, "not"))
     {
-        const std::string replace_text = "default(" + match[1].str() + ", " + match[2].str() + ")";
-
-        line = std::regex_replace(line, REGEX_replace_default_pipe, replace_text,
-                std::regex_constants::format_first_only);
+        is_negated = true;
+        next = word + 3;
+        word = skip_chars(line, next, is_space);
     }
-}
+    else
+        next += 2;
 
-void
-ecb::YjRender::transform_int_cast(
-    std::string& line, const std::map<std::string, nlohmann::json>& data)
-{
-    const auto REGEX_find_int_pipe = std::regex(R"(([\w.]+)(?=\|int))");
-    const auto REGEX_replace_int_pipe = std::regex(R"(([\w.]+\|int))");
+    if (word == next)
+        return pos;
 
-    for (std::smatch match ; std::regex_search(line, match, REGEX_find_int_pipe);)
+    if (is_word_at(line, word, "defined"))
     {
-        const std::string found_key = ecb::yj_common::cfg_key_to_json_key_string(match[1].str());
-        std::string replace_text = match[1];
+        expression = "isDefined(\"" + expression + "\")";
 
-        if (auto it = data.find(found_key); (it != data.end()) && (it->second.is_boolean()))
-            (it->second.get<bool>() == true) ? (replace_text = "1") : (replace_text = "0");
+        if (is_negated)
+            expression = "(not " + expression + ")";
 
-        line = std::regex_replace(line, REGEX_replace_int_pipe, replace_text,
-                std::regex_constants::format_first_only);
+        return word + 7;
     }
-}
 
-void
-ecb::YjRender::transform_default_int_cast(
-    std::string& line, const std::map<std::string, nlohmann::json>& data)
-{
-    const auto REGEX_find_default_int_pipe = std::regex(R"(([a-zA-Z0-9_\.]+)\|default\(([0-9A-Za-z$\{\}\(\)\.]+)(?=\)\|int))");
-    const auto REGEX_replace_default_int_pipe = std::regex(R"([a-zA-Z0-9_\.]+\|default\([0-9A-Za-z$\{\}\(\)\.]+\|int)");
-
-    for (std::smatch match ; std::regex_search(line, match, REGEX_find_default_int_pipe);)
+    if (!is_negated && is_word_at(line, word, "string"))
     {
-        std::string replace_text = "default(" + match[1].str() + ", " + match[2].str() + ")";
+        expression = "isString(" + expression + ")";
+        return word + 6;
+    }
 
-        // check if found key is a boolean
-        const std::string found_key = ecb::yj_common::cfg_key_to_json_key_string(match[1].str());
+    return pos;
+}
 
-        if (auto it = data.find(found_key); (it != data.end()) && (it->second.is_boolean()))
+// Rewrites the pipes `|int`, `|float` and `|default(X)` that follow
+// `expression` at `pos` from left to right. Returns the position after the
+// last pipe.
+static size_t
+transform_pipes(const std::string& line, size_t pos, std::string& expression)
+{
+    while ((pos < line.length()) && (line[pos] == '|'))
+    {
+        if (is_word_at(line, pos + 1, "int"))
+        {
+            expression = "toInt(" + expression + ")";
+            pos += 4;
+        }
+        else if (is_word_at(line, pos + 1, "float"))
         {
-            if (it->second.get<bool>() == true)
-                replace_text = "1";
-            else
-                replace_text = "0";
+            expression = "toFloat(" + expression + ")";
+            pos += 6;
         }
+        else if (line.compare(pos + 1, 8, "default(") == 0)
+        {
+            const size_t value_start = pos + 9;
+            const size_t value_end = find_closing_parenthesis(line, value_start);
+
+            if (value_end == std::string::npos)
+                break;
 
-        line = std::regex_replace(line, REGEX_replace_default_int_pipe, replace_text,
-                std::regex_constants::format_first_only);
+            std::string value = line.substr(value_start, value_end - value_start);
+            pos = value_end + 1;
 
+            if ((pos < line.length()) && (line[pos] == '|') && is_word_at(line, pos + 1, "float"))
+                value = to_float_default(value);
+
+            expression = "default(" + expression + ", " + value + ")";
+        }
+        else
+            break;
     }
+
+    return pos;
 }
 
 void
-ecb::YjRender::transform_default_float_cast(
-    std::string& line, const std::map<std::string, nlohmann::json>& data)
+ecb::YjRender::transform_expressions(std::string& line)
 {
-    const auto REGEX_find_default_float_pipe = std::regex(R"(([a-zA-Z0-9_\.]+)\|default\(([0-9A-Za-z$\{\}\(\)\.]+)(?=\)\|float))");
-    const auto REGEX_replace_default_float_pipe = std::regex(R"([a-zA-Z0-9_\.]+\|default\([0-9A-Za-z$\{\}\(\)\.]+\|float)");
+    std::string ret_val;
+    size_t pos = 0;
+
+    // end of the current block, "}}" or "%}" for an expression or a
+    // statement, "#}" for a comment, nullptr in literal text
+    const char* block_end = nullptr;
 
-    for (std::smatch match ; std::regex_search(line, match, REGEX_find_default_float_pipe);)
+    ret_val.reserve(line.length() + 32);
+
+    while (pos < line.length())
     {
-        double temp_default_value = 0;
+        const char c = line[pos];
+
+        if (block_end == nullptr)
+        {
+            if ((c == '{') && (pos + 1 < line.length()))
+            {
+                if (line[pos + 1] == '{')
+                    block_end = "}}";
+                else if (line[pos + 1] == '%')
+                    block_end = "%}";
+                else if (line[pos + 1] == '#')
+                    block_end = "#}";
+            }
+
+            const size_t length = (block_end != nullptr) ? 2 : 1;
+            ret_val.append(line, pos, length);
+            pos += length;
+            continue;
+        }
+
+        if (line.compare(pos, 2, block_end) == 0)
+        {
+            ret_val.append(block_end);
+            pos += 2;
+            block_end = nullptr;
+            continue;
+        }
 
-        try
+        if ((block_end[0] != '#') && ((c == '"') || (c == '\'')))
         {
-            temp_default_value = std::stod(match[2].str());
+            const size_t end = skip_string(line, pos);
+            ret_val.append(line, pos, end - pos);
+            pos = end;
+            continue;
         }
-        catch(...)
+
+        if ((block_end[0] == '#') || !is_key_char(c))
         {
-            std::cout << "transform_default_float_cast: cannot cast string to double" << std::endl;
+            ret_val += c;
+            ++pos;
+            continue;
         }
 
-        std::string default_value = std::to_string(temp_default_value);
-        std::string replace_text = "default(" + match[1].str() + ", " + default_value + ")";
+        // a key, a number or a keyword, e.g. `axis.id`, followed by a test
+        // or pipes
+        const size_t key_end = skip_chars(line, pos, is_key_char);
+        std::string expression = line.substr(pos, key_end - pos);
 
-        // check if found key is a number
-        const std::string found_key = ecb::yj_common::cfg_key_to_json_key_string(match[1].str());
+        pos = transform_test(line, key_end, expression);
 
-        if (auto it = data.find(found_key); (it != data.end()) && (it->second.is_number()))
+        if (pos == key_end)
         {
-            double temp_value = it->second.get<double>();
-            replace_text = std::to_string(temp_value);
+            if (expression == "loop.index0")
+                expression = "loop.index";
+
+            pos = transform_pipes(line, key_end, expression);
         }
 
-        line = std::regex_replace(line, REGEX_replace_default_float_pipe, replace_text,
-                std::regex_constants::format_first_only);
+        ret_val += expression;
     }
+
+    line = std::move(ret_val);
 }
 
-void
-ecb::YjRender::transform_float_cast(std::string& line,
-    const std::map<std::string, nlohmann::json>& data)
+std::string
+ecb::YjRender::find_include(const std::string& line)
 {
-    const auto REGEX_find_float_cast = std::regex(R"(([\w.]+)(?=\|float))");
-    const auto REGEX_remove_float_cast = std::regex(R"(([\w.]+\|float))");
+    // "{% include 'FILE' %}" at the beginning of the line
+    size_t pos = skip_chars(line, 0, is_space);
 
-    for (std::smatch match ; std::regex_search(line, match, REGEX_find_float_cast);)
-    {
-        std::string replace_text = match[1];
+    if (line.compare(pos, 2, "{%") != 0)
+        return {};
 
-        // check if found key is a number
-        const std::string found_key = ecb::yj_common::cfg_key_to_json_key_string(replace_text);
+    size_t next = skip_chars(line, pos + 2, is_space);
 
-        if (auto it = data.find(found_key); (it != data.end()) && (it->second.is_number()))
-        {
-            double x = it->second.get<float>();
-            replace_text = std::to_string(x);
-        }
+    if ((next == pos + 2) || (line.compare(next, 7, "include") != 0))
+        return {};
+
+    pos = next + 7;
+    next = skip_chars(line, pos, is_space);
+
+    if ((next == pos) || (next == line.length()) || ((line[next] != '"') && (line[next] != '\'')))
+        return {};
+
+    // FILE ends at the last quote that is followed by " %}"
+    const size_t start = next + 1;
+    const size_t limit = std::find_if(line.begin() + start, line.end(), is_line_terminator) - line.begin();
+
+    for (size_t end = std::min(limit, line.length() - 1); end > start; --end)
+    {
+        if ((line[end] != '"') && (line[end] != '\''))
+            continue;
+
+        next = skip_chars(line, end + 1, is_space);
 
-        line = std::regex_replace(line, REGEX_remove_float_cast, replace_text,
-                std::regex_constants::format_first_only);
+        if ((next > end + 1) && (line.compare(next, 2, "%}") == 0))
+            return line.substr(start, end - start);
     }
+
+    return {};
 }
 
 void
 ecb::YjRender::preprocess_line(std::string& line,
-    std::string& expanded_template, const std::string& template_base_dir,
-    const std::map<std::string, nlohmann::json>& flatten_data, int call_count)
+    YjPreprocessedFile& file, const std::string& template_base_dir,
+    std::vector<std::string>& include_stack)
 {
-    if (call_count > ECMC_YJ_RENDER_MAX_INCLUDE_DEPTH)
-        throw std::runtime_error("template: limit of nested includes is exceed. Limit: ECMC_YJ_RENDER_MAX_INCLUDE_DEPTH");
+    std::string& expanded_template = file.content;
+    file.levels = std::max(file.levels, 1);
+
+    yj_profile::count("template_lines_preprocessed");
 
     // handle line without inja syntax
     if ((line.find(R"({%)") == std::string::npos) && (line.find(R"({{)") == std::string::npos))
@@ -345,61 +974,33 @@ ecb::YjRender::preprocess_line(std::string& line,
         return;
     }
 
+    const std::string include_file = find_include(line);
 
-
-    if (line.find("include") != std::string::npos)
+    if (!include_file.empty())
     {
-        const auto REGEX_find_include = std::regex(R"(^\s*\{\%\s+include\s+["'](.+)["']\s+\%\})");
-        std::smatch match;
-
-        std::regex_search(line, match, REGEX_find_include);
+        const std::string include_path = template_base_dir + "/" + include_file;
 
         // include statement found, so include the content of this file
-        std::ifstream include_file(template_base_dir + "/" + match[1].str());
+        const auto included_file = get_preprocessed_file(include_path, template_base_dir,
+                include_stack);
 
-        if (!include_file)
-            throw std::runtime_error("include file not found: " + match[1].str());
+        if (included_file == nullptr)
+            throw std::runtime_error("include file not found: " + include_file);
 
-        std::string included_line;
+        expanded_template += included_file->content;
+        file.levels = std::max(file.levels, included_file->levels + 1);
+        add_unique(file.includes, include_path);
+        add_unique(file.closure, include_path);
 
-        while (std::getline(include_file, included_line))
-            preprocess_line(included_line, expanded_template, template_base_dir,
-                flatten_data, call_count + 1);
+        for (const auto& closure_file : included_file->closure)
+            add_unique(file.closure, closure_file);
+
+        for (const auto& dependency : included_file->dependencies)
+            add_unique_dependency(file.dependencies, dependency);
     }
     else
     {
-        bool contains_default = false;
-
-        if (line.find(R"(|default)") != std::string::npos)
-            contains_default = true;
-
-        if (line.find(R"(is)") != std::string::npos)
-        {
-            if (line.find(R"(defined)") != std::string::npos)
-                transform_is_defined(line, flatten_data);
-
-            if (line.find(R"(string)") != std::string::npos)
-                transform_is_string(line);
-        }
-
-        if (line.find("index0") != std::string::npos)
-            transform_loop_index0(line);
-
-        if (contains_default)
-            transform_default_int_cast(line, flatten_data);
-
-        if (line.find("|float") != std::string::npos)
-        {
-            transform_default_float_cast(line, flatten_data);
-            transform_float_cast(line, flatten_data);
-        }
-
-        if (contains_default)
-            transform_default(line);
-
-        if (line.find("|int") != std::string::npos)
-            transform_int_cast(line, flatten_data);
-
+        transform_expressions(line);
         yj_common::remove_whitespaces(line);
 
         if (line.length() != 0)
@@ -20,17 +20,100 @@
 #define _YJ_RENDER_H_
 
 #include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
+#include <ostream>
 #include <string>
+#include <vector>
+
+#include "yj_key_index.h"
 
 #define ECMC_YJ_RENDER_MAX_INCLUDE_DEPTH 5
 
+namespace inja
+{
+class Environment;
+struct Template;
+}
+
 namespace ecb
 {
+// Content of a template file split into lines.
+struct YjTemplateFile
+{
+    std::vector<std::string> lines;
+
+    // state of the file as it was read, see `yj_common::get_file_state`
+    nlohmann::json file_state;
+};
+
+
+// A template file after preprocessing.
+struct YjPreprocessedTemplate
+{
+    // preprocessed template, all includes are expanded
+    std::string content;
+
+    // include closure of the template, all included files in the order they
+    // are included first
+    std::vector<std::string> includes;
+
+    // states of the template and of all included files as they were read
+    // (see `yj_common::get_file_state`), the cached template is used as
+    // long as they are unchanged
+    std::vector<nlohmann::json> dependencies;
+
+    // parsed `content`, nullptr until the template is rendered the first time
+    std::shared_ptr<const inja::Template> parsed;
+};
+
+
+// A template file after preprocessing, as it is inserted where the file is
+// included. Each file is preprocessed only once per template directory.
+struct YjPreprocessedFile
+{
+    // preprocessed lines of the file, all includes are expanded
+    std::string content;
+
+    // files included by this file itself, in the order they are included
+    // first; the edges of the include graph
+    std::vector<std::string> includes;
+
+    // include closure of the file, all files included directly or indirectly
+    // in the order they are included first
+    std::vector<std::string> closure;
+
+    // number of nested include levels of the file, 1 for a file without
+    // includes and 0 for an empty file
+    int levels = 0;
+
+    // states of the file and of all files in `closure` as they were read,
+    // see `YjPreprocessedTemplate::dependencies`
+    std::vector<nlohmann::json> dependencies;
+};
+
+
+// Number of renders that reused a parsed template (hits) and that had to
+// preprocess and parse the template (misses).
+struct YjTemplateCacheStats
+{
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+
 class YjRender
 {
 public:
 
+    // Creates the Inja environment, which is reused for all calls of
+    // `render`, and registers the callbacks `isDefined`, `toInt` and
+    // `toFloat`. `render` can be called from several threads at the same
+    // time.
+    YjRender();
+
     // Renders the Jinja2 template provided in `templateContent` / `filename`.
     // First the template is preprocessed (see `preprocess_line`), and then
     // Inja is called. If Inja throws an exception, the corresponding context
@@ -46,96 +129,225 @@ public:
         const std::string& templateDir,
         nlohmann::json& data);
 
+    // Same as above, `keys` are the keys of `data` (see
+    // `YjValidationResult::keys`), so they don't have to be collected again.
+    std::string render(
+        const std::string& filename,
+        const std::string& templateDir,
+        nlohmann::json& data,
+        const YjKeyIndex& keys);
+
+    // Same as above, but the configuration is written to `output` while it
+    // is rendered instead of being returned as a string. The last newline is
+    // not written, like it is removed from the returned string. Returns
+    // false if Inja failed with a JSON exception; in this case `output`
+    // contains an incomplete configuration.
+    bool render(
+        const std::string& filename,
+        const std::string& templateDir,
+        nlohmann::json& data,
+        const YjKeyIndex& keys,
+        std::ostream& output);
+
+    // Same as above, the states of the template and of all included files
+    // as they were read for this render (see
+    // `YjPreprocessedTemplate::dependencies`) are appended to
+    // `dependencies`.
+    bool render(
+        const std::string& filename,
+        const std::string& templateDir,
+        nlohmann::json& data,
+        const YjKeyIndex& keys,
+        std::ostream& output,
+        std::vector<nlohmann::json>& dependencies);
+
+
+    // Returns the template `filename` after preprocessing, which is the Inja
+    // template that `render` renders. The result is cached like in `render`.
+    std::string preprocess(
+        const std::string& filename,
+        const std::string& templateDir);
+
+
+    // Returns the include closure of the template `filename`, all included
+    // files in the order they are included first. The template is
+    // preprocessed if it is not cached yet.
+    std::vector<std::string> get_includes(
+        const std::string& filename,
+        const std::string& templateDir);
+
+
+    // Returns the include graph of the template `filename`: for the template
+    // and every file it includes, the files this file includes directly (see
+    // `YjPreprocessedFile::includes`). The files are preprocessed if they
+    // are not cached yet.
+    std::map<std::string, std::vector<std::string>> get_include_graph(
+        const std::string& filename,
+        const std::string& templateDir);
+
+
+    // Returns the hits and misses of the template cache. Only templates that
+    // are rendered by filename are cached.
+    YjTemplateCacheStats get_template_cache_stats();
+
+
+    // Stores preprocessed templates in the directory `cache_dir`, so that
+    // later processes can use them without reading the included files. An
+    // entry is used as long as the template and all included files are
+    // unchanged. An empty string disables the cache, which is the default.
+    // Call this function before rendering.
+    void set_cache_dir(
+        const std::string& cache_dir);
+
 private:
+    // Not modified after construction, the preprocessed templates contain
+    // no includes, so Inja only reads the environment while parsing.
+    std::shared_ptr<inja::Environment> env_;
 
-    // Preprocesses the given line and adds the result to `expanded_template`.
-    // This function handles `include` statements in the Jinja2 templates and
-    // applies all transform functions to each line.  Note: this function uses
-    // recursion calls to include files. The maximum recursion/include depth is
-    // set in `ECMC_YJ_RENDER_MAX_IN´CLUDE_DEPTH`.
-    void preprocess_line(
-        std::string& line,
-        std::string& expanded_template,
+    // Content of template files split into lines, the key is the path of
+    // the file. Each template file is read only once, unless it changes.
+    // All cached entries below are dropped when they are looked up and one
+    // of the files they were made from has changed since it was read.
+    std::map<std::string, std::shared_ptr<const YjTemplateFile>> template_files_;
+
+    // Preprocessed and parsed templates, the key is the path of the template
+    // file and the template directory, which together determine the include
+    // closure.
+    std::map<std::pair<std::string, std::string>, std::shared_ptr<YjPreprocessedTemplate>> templates_;
+    YjTemplateCacheStats template_cache_stats_;
+
+    // Preprocessed template files, including the files that are only
+    // included by other templates. The key is the path of the file and the
+    // template directory.
+    std::map<std::pair<std::string, std::string>, std::shared_ptr<const YjPreprocessedFile>>
+    preprocessed_files_;
+
+    // protects `template_files_`, `templates_`, `template_cache_stats_` and
+    // `preprocessed_files_`
+    std::shared_ptr<std::mutex> template_files_mutex_;
+
+    // directory of the on-disk template cache, empty if disabled
+    std::string cache_dir_;
+
+    // Returns the lines of the template file `filename`. The file is only
+    // read on the first call, subsequent calls return the cached lines as
+    // long as the file is unchanged. Returns nullptr if the file cannot be
+    // read. The file is read without holding `template_files_mutex_`, like
+    // files are preprocessed in `get_preprocessed_file`.
+    std::shared_ptr<const YjTemplateFile> read_template_file(
+        const std::string& filename);
+
+
+    // Returns the file `filename` after preprocessing. The file is only
+    // preprocessed on the first call, subsequent calls with the same
+    // template directory return the cached result as long as the file and
+    // the files it includes are unchanged. `include_stack` are the
+    // files that are being preprocessed and include `filename`; an exception
+    // is thrown if `filename` is one of them. Returns nullptr if the file
+    // cannot be read.
+    std::shared_ptr<const YjPreprocessedFile> get_preprocessed_file(
+        const std::string& filename,
         const std::string& template_dir,
-        const std::map<std::string, nlohmann::json>& flatten_data, int call_count);
+        std::vector<std::string>& include_stack);
 
 
-    // Replaces all occurrences of `K|float` with `K` in the given line. If K
-    // is a number then it is casted to a float, otherwise it is left
-    // unchanged. If no occurrences are found, the line remains unchanged.
-    void transform_float_cast(
-        std::string& line,
-        const std::map<std::string, nlohmann::json>& data);
+    // Returns the preprocessed template file `filename`. The template is
+    // only preprocessed on the first call, subsequent calls with the same
+    // template directory return the cached template as long as the template
+    // and the files it includes are unchanged.
+    std::shared_ptr<YjPreprocessedTemplate> get_preprocessed_template(
+        const std::string& filename,
+        const std::string& template_dir);
 
 
-    // Remove leading and trailing whitespaces from line.
-    void remove_whitespaces(
-        std::string& line);
+    // Returns the filename of the on-disk cache entry of the template
+    // `filename` in the template directory `template_dir`.
+    std::string get_cache_filename(
+        const std::string& filename,
+        const std::string& template_dir);
 
-    // Replaces all occurrences of `K|default(X)`with `default(K, X)` in the
-    // given line. This transformation is necessary because Inja does not
-    // support pipe operations. If no occurrences are found, the line remains
-    // unchanged.
-    void transform_default(
-        std::string& line);
 
+    // Returns the preprocessed template from the on-disk cache. Returns
+    // nullptr if there is no entry, if the entry was written by another
+    // version of ECB, or if the template or one of the included files has
+    // changed. Files with unchanged size and modification time are not read.
+    std::shared_ptr<YjPreprocessedTemplate> read_cached_template(
+        const std::string& filename,
+        const std::string& template_dir);
 
-    // Replaces all occurrences of `K|int` in the given line according to the
-    // following logic:
-    //
-    // `K|int` where VAL(K)=true -> 1
-    // `K|int` where VAL(K)=false -> 0
-    // `K|int` -> K
-    //
-    // If K is a boolean, it is converted to 1 or 0 based on its value. In all
-    // other cases, the pipe is replaced with the key (K) before the pipe.
-    // Floats are not rounded or truncated.  This transformation is necessary
-    // because Inja does not support pipe operations. If no occurrences are
-    // found, the line remains unchanged.
-    void transform_int_cast(
-        std::string& line,
-        const std::map<std::string, nlohmann::json>& data);
 
+    // Writes the preprocessed template to the on-disk cache. The entry
+    // records the dependencies of the template, the states of the template
+    // and of all included files as they were read. Errors are ignored, the
+    // cache is only an optimization.
+    void write_cached_template(
+        const std::string& filename,
+        const std::string& template_dir,
+        const YjPreprocessedTemplate& preprocessed_template);
 
-    // Replaces all occurrences of `K|default(X)|int` with `default(K, X)` in
-    // the given line. ECMC functions that except numbers can handle int and
-    // float, so it is safe to remove the cast. If `K` is a bool, then true is
-    // converted to 1 and false to 0. If no occurrences are found, the line
-    // remains unchanged.
-    void transform_default_int_cast(
-        std::string& line,
-        const std::map<std::string, nlohmann::json>& data);
+
+    // Renders the already preprocessed template with Inja into `output`,
+    // without the last newline. If `parsed` is nullptr, the template is
+    // parsed first and `parsed` is set. `keys` are the keys of `data`, which
+    // are used by the callback `isDefined`. If Inja throws an exception, the
+    // corresponding context is printed to stdout. Returns false if the
+    // exception was a JSON exception, other exceptions are rethrown.
+    bool render_preprocessed(
+        const std::string& preprocessed_template,
+        std::shared_ptr<const inja::Template>& parsed,
+        nlohmann::json& data,
+        const YjKeyIndex& keys,
+        std::ostream& output);
 
 
-    // Replaces all occurrences of `K|default(X)|float` with `default(K, X)` in
-    // the given line. If X is a number it is casted to a float, otherwise
-    // leave unchanged. If no occurrences are found, the line remains
-    // unchanged.
-    void transform_default_float_cast(
+    // Preprocesses the given line and adds the result to `file`. This
+    // function handles `include` statements in the Jinja2 templates and
+    // applies all transform functions to each line. An included file is
+    // preprocessed once (see `get_preprocessed_file`) and its content is
+    // inserted; the file and its include closure are added to `file`. The
+    // result depends only on the template files, not on the data. The
+    // maximum include depth is set in `ECMC_YJ_RENDER_MAX_INCLUDE_DEPTH`, it
+    // is checked for the whole template after preprocessing.
+    void preprocess_line(
         std::string& line,
-        const std::map<std::string, nlohmann::json>& data);
+        YjPreprocessedFile& file,
+        const std::string& template_dir,
+        std::vector<std::string>& include_stack);
 
 
-    // Replaces all occurrences of `is defined` or `is not defined` in the
-    // given line. The expression is replaced with `true/false`, depending on
-    // whether the given key is defined or not. If no occurrences are found,
-    // the line remains unchanged.
-    void transform_is_defined(
-        std::string& line,
-        const std::map<std::string, nlohmann::json>& data);
+    // Returns the filename of the statement `{% include "FILE" %}` at the
+    // beginning of `line`. Returns an empty string if the line contains no
+    // include statement.
+    std::string find_include(
+        const std::string& line);
 
 
-    // Replaces all occurrences of `is string X` with `isString(X)` in the
-    // given line. The expression `is string` is not supported by Inja. If no
-    // occurrences are found, the line remains unchanged.
-    void transform_is_string(
+    // Remove leading and trailing whitespaces from line.
+    void remove_whitespaces(
         std::string& line);
 
 
-    // Replaces all occurrences of `loop.index0` with `loop.index` in the given
-    // line. This is necessary due to different conventions between Jinja2 and
-    // Inja. If no occurrences are found, the line remains unchanged.
-    void transform_loop_index0(
+    // Rewrites the Jinja2 expressions in `line` that Inja does not support
+    // into calls of the callbacks registered by the constructor. The line is
+    // scanned once; only the contents of `{{ }}` and `{% %}` blocks are
+    // rewritten, literal text, comments and string literals are kept:
+    //
+    // `K is defined`     -> `isDefined("K")`
+    // `K is not defined` -> `(not isDefined("K"))`
+    // `K is string`      -> `isString(K)`
+    // `loop.index0`      -> `loop.index`
+    // `K|int`            -> `toInt(K)`
+    // `K|float`          -> `toFloat(K)`
+    // `K|default(X)`     -> `default(K, X)`
+    //
+    // Pipes are applied from left to right, e.g. `K|default(X)|int` becomes
+    // `toInt(default(K, X))`, and the default value X of
+    // `K|default(X)|float` is converted to a float while preprocessing.
+    // `isDefined` is true if the key or a key starting with it exists in the
+    // data. `toInt` converts booleans to 1 or 0 and returns all other values
+    // unchanged, floats are not rounded or truncated. `toFloat` converts
+    // numbers to floats.
+    void transform_expressions(
         std::string& line);
 };
 }
@@ -16,6 +16,9 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <filesystem>
+#include <fstream>
+
 #include "gtest/gtest.h"
 #include "nlohmann/json.hpp"
 #include "yj_render.h"
@@ -353,6 +356,16 @@ TEST_F(YjRenderFixture, replace_floatCast_two)
     EXPECT_EQ(result.compare(expect), 0) << "result is: " << result;
 }
 
+TEST_F(YjRenderFixture, replace_floatCast_precision)
+{
+    j1["/keya/1"_json_pointer] = 1000.123456;
+    input.str("ecmcConfigOrDie(XYDWD, {{keya.1|float}})");
+    expect = "ecmcConfigOrDie(XYDWD, 1000.123456)";
+
+    result = dut1.render(input, "", j1);
+    EXPECT_EQ(result.compare(expect), 0) << "result is: " << result;
+}
+
 TEST_F(YjRenderFixture, replace_floatCast_wrongCase)
 {
     input.str("ecmcConfigOrDie(XYDWD, {{keya.1|Float}}");
@@ -403,6 +416,16 @@ TEST_F(YjRenderFixture, replace_floatDefaultCast_four)
     EXPECT_EQ(result.compare(expect), 0) << "result is: " << result;
 }
 
+TEST_F(YjRenderFixture, replace_pipesInOneExpression)
+{
+    j1["/keya/1"_json_pointer] = true;
+    input.str("{{ keya.1|default(0)|int + keyb.1|default(2)|int }} {{ \"keya.1|int\" }}");
+    expect = "3 keya.1|int";
+
+    result = dut1.render(input, "", j1);
+    EXPECT_EQ(result.compare(expect), 0) << "result is: " << result;
+}
+
 TEST_F(YjRenderFixture, readTemplate)
 {
     j1["/key1/a"_json_pointer] = 2;
@@ -415,6 +438,146 @@ TEST_F(YjRenderFixture, readTemplate)
     EXPECT_EQ(output.compare(expect), 0);
 }
 
+TEST_F(YjRenderFixture, renderToStream)
+{
+    j1["/key1/a"_json_pointer] = 2;
+    j1["/key2/a"_json_pointer] = 2;
+
+    std::ostringstream output;
+    EXPECT_TRUE(dut1.render("../scripts/templates/file1.inja", "../scripts/templates", j1,
+            YjKeyIndex(j1), output));
+    EXPECT_TRUE(output.str() == "f1:A\nf2:A\nf3:A\nf2:B\nf1:B");
+
+    // only the last newline is removed
+    input.str("{{ text }}{{ text }}");
+    j1["text"] = "a\n\n";
+    result = dut1.render(input, "", j1);
+    EXPECT_TRUE(result == "a\n\na\n\n") << result;
+}
+
+TEST_F(YjRenderFixture, templateCache)
+{
+    j1["/key1/a"_json_pointer] = 2;
+    j1["/key2/a"_json_pointer] = 2;
+
+    std::string output1 = dut1.render("../scripts/templates/file1.inja", "../scripts/templates", j1);
+    std::string output2 = dut1.render("../scripts/templates/file1.inja", "../scripts/templates", j1);
+    EXPECT_TRUE(output1 == output2);
+
+    auto dut2 = dut1.get_template_cache_stats();
+    EXPECT_TRUE(dut2.hits == 1);
+    EXPECT_TRUE(dut2.misses == 1);
+
+    // same template with other data
+    j1.erase("key2");
+    EXPECT_TRUE(dut1.render("../scripts/templates/file1.inja", "../scripts/templates", j1)
+        == "f1:A\nf2:B\nf1:B");
+    EXPECT_TRUE(dut1.get_template_cache_stats().hits == 2);
+
+    // the preprocessed template is taken from the cache
+    EXPECT_TRUE(dut1.preprocess("../scripts/templates/file1.inja", "../scripts/templates")
+        .find("isDefined(\"key1.a\")") != std::string::npos);
+    EXPECT_TRUE(dut1.get_template_cache_stats().misses == 1);
+}
+
+TEST_F(YjRenderFixture, diskCache)
+{
+    namespace fs = std::filesystem;
+
+    const fs::path dir = fs::temp_directory_path() / "ecb_yj_render_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir / "templates");
+
+    for (const auto* file : {"file1.inja", "file2.inja", "file3.inja"})
+        fs::copy_file(fs::path("../scripts/templates") / file, dir / "templates" / file);
+
+    const std::string template_dir = (dir / "templates").string();
+    const std::string filename = template_dir + "/file1.inja";
+    j1["/key1/a"_json_pointer] = 2;
+    j1["/key2/a"_json_pointer] = 2;
+
+    dut1.set_cache_dir((dir / "cache").string());
+    const std::string output1 = dut1.render(filename, template_dir, j1);
+    EXPECT_TRUE(std::distance(fs::directory_iterator(dir / "cache"), fs::directory_iterator()) == 1);
+
+    // a new object uses the entry written by the first one
+    YjRender dut2;
+    dut2.set_cache_dir((dir / "cache").string());
+    EXPECT_TRUE(dut2.render(filename, template_dir, j1) == output1);
+
+    // an included file changes, its size stays the same
+    std::ofstream(dir / "templates" / "file3.inja") << "f3:X";
+    fs::last_write_time(dir / "templates" / "file3.inja",
+        fs::last_write_time(dir / "templates" / "file3.inja") + std::chrono::seconds(10));
+
+    YjRender dut3;
+    dut3.set_cache_dir((dir / "cache").string());
+    const std::string output3 = dut3.render(filename, template_dir, j1);
+    EXPECT_TRUE(output3.find("f3:X") != std::string::npos);
+    EXPECT_TRUE(output3.find("f3:A") == std::string::npos);
+
+    fs::remove_all(dir);
+}
+
+TEST_F(YjRenderFixture, includeGraph)
+{
+    namespace fs = std::filesystem;
+
+    const fs::path dir = fs::temp_directory_path() / "ecb_yj_render_include_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    std::ofstream(dir / "main.inja") << "{% include 'a.inja' %}\n{% include 'b.inja' %}\nmain";
+    std::ofstream(dir / "a.inja") << "{% include 'c.inja' %}\na";
+    std::ofstream(dir / "b.inja") << "{% include 'c.inja' %}\nb";
+    std::ofstream(dir / "c.inja") << "{{ c }}";
+    std::ofstream(dir / "x.inja") << "{% include 'y.inja' %}";
+    std::ofstream(dir / "y.inja") << "{% include 'x.inja' %}";
+
+    for (int i = 0; i < 6; ++i)
+        std::ofstream(dir / ("d" + std::to_string(i) + ".inja"))
+                << "{% include 'd" + std::to_string(i + 1) + ".inja' %}";
+
+    std::ofstream(dir / "d6.inja") << "d";
+
+    const std::string template_dir = dir.string();
+    const std::string filename = template_dir + "/main.inja";
+    j1["c"] = 1;
+
+    EXPECT_TRUE(dut1.render(filename, template_dir, j1) == "1\na\n1\nb\nmain");
+    EXPECT_TRUE(dut1.get_includes(filename, template_dir) == std::vector<std::string>({
+        template_dir + "/a.inja", template_dir + "/c.inja", template_dir + "/b.inja"}));
+
+    auto dut2 = dut1.get_include_graph(filename, template_dir);
+    ASSERT_EQ(dut2.size(), 4);
+    EXPECT_TRUE(dut2[filename] == std::vector<std::string>({template_dir + "/a.inja",
+            template_dir + "/b.inja"}));
+    EXPECT_TRUE(dut2[template_dir + "/b.inja"] == std::vector<std::string>({template_dir +
+            "/c.inja"}));
+    EXPECT_TRUE(dut2[template_dir + "/c.inja"].empty());
+
+    // the preprocessed file is reused by a template that includes it
+    input.str("{% include 'a.inja' %}");
+    EXPECT_TRUE(dut1.render(input, template_dir, j1) == "1\na");
+
+    try
+    {
+        dut1.preprocess(template_dir + "/x.inja", template_dir);
+        FAIL() << "cyclic include not detected";
+    }
+    catch (const std::runtime_error& e)
+    {
+        EXPECT_TRUE(std::string(e.what()).find("cyclic include: " + template_dir + "/x.inja -> " +
+                template_dir + "/y.inja -> " + template_dir + "/x.inja") != std::string::npos)
+                << e.what();
+    }
+
+    EXPECT_NO_THROW(dut1.preprocess(template_dir + "/d2.inja", template_dir));
+    EXPECT_THROW(dut1.preprocess(template_dir + "/d1.inja", template_dir), std::runtime_error);
+
+    fs::remove_all(dir);
+}
+
 TEST_F(YjRenderFixture, include_ok)
 {
     input.str(" {% include \'../scripts/templates/file3.inja\' %}");
@@ -424,6 +587,18 @@ TEST_F(YjRenderFixture, include_ok)
     EXPECT_EQ(result.compare(expect), 0) << "result is: " << result;
 }
 
+TEST_F(YjRenderFixture, include_onlyIncludeStatement)
+{
+    // lines that contain "include" but no include statement are rendered
+    j1["/axis/includeX"_json_pointer] = 3;
+    input.str("{{ axis.includeX }}\ninclude {{ axis.includeX|int }}\n"
+        "{% if axis.includeX %}x{% endif %}");
+    expect = "3\ninclude 3\nx";
+
+    result = dut1.render(input, ".", j1);
+    EXPECT_EQ(result.compare(expect), 0) << "result is: " << result;
+}
+
 TEST_F(YjRenderFixture, default_int_key_defined)
 {
     j1["/keya/1"_json_pointer] = 2;
@@ -493,6 +668,38 @@ TEST_F(YjRenderFixture, default_int_two)
     EXPECT_EQ(result.compare(expect), 0) << "result is: " << result;
 }
 
+TEST_F(YjRenderFixture, callbacks_dataIndependent)
+{
+    // the same template is preprocessed the same way for different data
+    const std::string text = "{% if key1.a is defined %}{{ key1.a|int }}{% else %}NONE{% endif %}";
+
+    j1["/key1/a"_json_pointer] = true;
+    input.str(text);
+    EXPECT_TRUE(dut1.render(input, "", j1) == "1");
+
+    j1.clear();
+    input.clear();
+    input.str(text);
+    EXPECT_TRUE(dut1.render(input, "", j1) == "NONE");
+
+    j1["/key1/a"_json_pointer] = 7;
+    input.clear();
+    input.str("{{ toInt(key1.a) }} {{ isDefined(\"key1\") }} {{ toFloat(key1.a) }}");
+    EXPECT_TRUE(dut1.render(input, "", j1) == "7 true 7.0");
+}
+
+TEST_F(YjRenderFixture, callbacks_onlyInExpressions)
+{
+    // literal text next to an expression is not rewritten
+    j1["/key1/a"_json_pointer] = true;
+    input.str("x is defined {{ key1.a is defined }} y is not defined {{ key1.a|int }} "
+        "loop.index0 z|int");
+    expect = "x is defined true y is not defined 1 loop.index0 z|int";
+
+    result = dut1.render(input, "", j1);
+    EXPECT_EQ(result.compare(expect), 0) << "result is: " << result;
+}
+
 TEST_F(YjRenderFixture, cyclicIncludes)
 {
     EXPECT_THROW(dut1.render("../scripts/templates/fileA.inja", "../scripts/templates", j1),
@@ -16,126 +16,229 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
-#include <regex>
+#include <unordered_set>
 
 #include "yj_common.h"
+#include "yj_file.h"
+#include "yj_profile.h"
 #include "yj_schema.h"
 
 using nlohmann::json;
 
-const std::regex REGEX_norm_pair = std::regex(R"(\s*(.+?)=(.+))");
-
 
 ecb::YjSchema::YjSchema(std::string filename_schema, const std::string& selected_schema)
+    : YjSchema(load_schema(filename_schema), selected_schema)
 {
-    std::ifstream ifs(filename_schema);
+}
 
-    if (!ifs)
-        throw std::runtime_error("schema file not found: " + filename_schema);
+ecb::YjSchema::YjSchema(std::istream& schema, const std::string& selected_schema)
+    : YjSchema(load_schema(schema), selected_schema)
+{
+}
 
-    schema_ = nlohmann::json::parse(ifs);
-    schema_ = schema_.flatten();
+ecb::YjSchema::YjSchema(std::shared_ptr<const YjSchemaIndex> schema,
+    const std::string& selected_schema)
+{
+    schema_ = std::move(schema);
     grand_schema_ = selected_schema;
     is_schemas_fetched_ = false;
 }
 
-ecb::YjSchema::YjSchema(std::istream& schema, const std::string& selected_schema)
+std::shared_ptr<const ecb::YjSchemaIndex>
+ecb::YjSchema::load_schema(const std::string& filename_schema)
 {
-    schema_ = nlohmann::json::parse(schema);
-    schema_ = schema_.flatten();
-    grand_schema_ = selected_schema;
-    is_schemas_fetched_ = false;
+    nlohmann::json file_state;
+
+    return load_schema(filename_schema, file_state);
+}
+
+std::shared_ptr<const ecb::YjSchemaIndex>
+ecb::YjSchema::load_schema(const std::string& filename_schema, nlohmann::json& file_state)
+{
+    YjProfileTimer timer("schema.load");
+
+    YjFile schema_content(filename_schema);
+
+    if (!schema_content.is_open())
+        throw std::runtime_error("schema file not found: " + filename_schema);
+
+    file_state = yj_common::get_file_state(schema_content);
+
+    const auto content = schema_content.get_content();
+
+    // compiled with `--action compileschema`
+    if (YjSchemaIndex::is_binary(content))
+        return std::make_shared<const YjSchemaIndex>(YjSchemaIndex::from_binary(content));
+
+    auto schema_data = nlohmann::json::parse(content.begin(), content.end());
+    yj_profile::count("flatten_calls");
+    return std::make_shared<const YjSchemaIndex>(schema_data.flatten());
+}
+
+std::shared_ptr<const ecb::YjSchemaIndex>
+ecb::YjSchema::load_schema(std::istream& schema)
+{
+    YjProfileTimer timer("schema.load");
+
+    auto schema_data = nlohmann::json::parse(schema);
+    yj_profile::count("flatten_calls");
+    return std::make_shared<const YjSchemaIndex>(schema_data.flatten());
+}
+
+ecb::YjValidationResult
+ecb::YjSchema::validate(nlohmann::json& cfg_data)
+{
+    YjValidationResult ret_val;
+
+    // pre-eval axis.type
+    if (grand_schema_ == "axis")
+        add_default_value_from_key(cfg_data, "axis.type");
+    else if ((grand_schema_ == "plc") || (grand_schema_ == "encoder"))
+        cfg_data["/meta/schemaNumber"_json_pointer] = 0;
+
+    auto cfg_keys = collect_keys(cfg_data);
+
+    normalize(cfg_data, cfg_keys);
+
+    add_schema_default_values(cfg_data, cfg_keys);
+    check_and_normalize_datatypes(cfg_data, cfg_keys);
+    normalize(cfg_data, cfg_keys);
+
+    if (grand_schema_ == "axis")
+    {
+        cfg_data["/meta/schemaNumber"_json_pointer] = cfg_data["/axis/type"_json_pointer];
+        add_key("/axis/type", cfg_data, cfg_keys);
+        add_key("/meta/schemaNumber", cfg_data, cfg_keys);
+    }
+
+    check_min_max_ranges(cfg_data, cfg_keys);
+    check_schema(grand_schema_, cfg_data, cfg_keys);
+    check_for_valid_keys(cfg_keys);
+
+    ret_val.removed_keys = remove_undefined_keys(cfg_data, cfg_keys);
+    ret_val.used_schemas = used_schemas_;
+    ret_val.keys = std::move(cfg_keys.keys);
+
+    for (const auto& removed_key : ret_val.removed_keys)
+        ret_val.keys.remove(removed_key);
+
+    ret_val.key_count = ret_val.keys.get_leaves().size();
+
+    return ret_val;
+}
+
+ecb::YjConfigKeys
+ecb::YjSchema::collect_keys(const nlohmann::json& cfg_data)
+{
+    YjProfileTimer timer("schema.collect_keys");
+
+    YjConfigKeys ret_val;
+    ret_val.keys = YjKeyIndex(cfg_data);
+
+    for (const auto& node : ret_val.keys.get_nodes())
+        schema_->append_definitions(node, ret_val.definitions);
+
+    std::sort(ret_val.definitions.begin(), ret_val.definitions.end());
+
+    return ret_val;
 }
 
 void
-ecb::YjSchema::normalize(json& yaml_data)
+ecb::YjSchema::add_key(const std::string& key, const nlohmann::json& cfg_data, YjConfigKeys& cfg_keys)
 {
-    for (const auto& schema_entry : schema_.items())
+    std::vector<std::string> new_nodes;
+
+    // the value has or had children, collect all keys again
+    if (!cfg_keys.keys.add(key, cfg_data, new_nodes))
     {
-        // quick check if this is a normalize key
-        if (schema_entry.key().find("normalize") == std::string::npos)
-            continue;
+        cfg_keys = collect_keys(cfg_data);
+        return;
+    }
 
-        std::smatch key_to_normalize;
-        if (std::regex_search(schema_entry.key(), key_to_normalize,
-            std::regex(R"(.*\/(.*)\/(?=(normalize)))")))
-        {
-            const auto key_ptr = ecb::yj_common::generate_json_pointer(key_to_normalize[1].str());
+    const size_t count = cfg_keys.definitions.size();
 
-            for (const auto& val : schema_entry.value())
-            {
-                const auto split = ecb::yj_common::tokenize(
-                        val,
-                        ecb::yj_common::REGEX_token_sep_space);
+    for (const auto& node : new_nodes)
+        schema_->append_definitions(node, cfg_keys.definitions);
 
-                // skip if there is nothing to do
-                if (yaml_data.contains(key_ptr) == false || split.size() < 2)
-                    continue;
+    if (cfg_keys.definitions.size() != count)
+        std::sort(cfg_keys.definitions.begin(), cfg_keys.definitions.end());
+}
 
-                // normalize (string=* types
-                if ( (split[0].find("\(string") == 0) && yaml_data[key_ptr].is_string())
-                {
-                    for (auto norm_values = std::next(split.cbegin()) ; norm_values != split.cend();
-                        ++norm_values)
-                    {
-                        std::smatch norm_pair;
-                        std::regex_search(*norm_values, norm_pair, REGEX_norm_pair);
+void
+ecb::YjSchema::normalize(json& yaml_data)
+{
+    normalize(yaml_data, collect_keys(yaml_data));
+}
 
-                        std::string from_yaml = yaml_data[key_ptr];
-                        std::string from_scheme = norm_pair[1];
+void
+ecb::YjSchema::normalize(json& yaml_data, const YjConfigKeys& cfg_keys)
+{
+    YjProfileTimer timer("schema.normalize");
 
-                        // remove whitespaces
-                        if (split[0] == "(string_remove_whitespaces=integer)")
-                            ecb::yj_common::replace_substring(from_yaml, " ", "");
+    for (const auto* definition : cfg_keys.definitions)
+    {
+        const auto& key_ptr = definition->pointer;
 
-                        // use lower casing for comparison
-                        ecb::yj_common::to_lower(from_yaml);
-                        ecb::yj_common::to_lower(from_scheme);
+        for (const auto& rule : definition->normalize)
+        {
+            // normalize (string=* types
+            if ((rule.conversion.find("(string") == 0) && yaml_data[key_ptr].is_string())
+            {
+                for (const auto& norm_pair : rule.values)
+                {
+                    std::string from_yaml = yaml_data[key_ptr];
+                    std::string from_scheme = norm_pair.first;
+
+                    // remove whitespaces
+                    if (rule.conversion == "(string_remove_whitespaces=integer)")
+                        ecb::yj_common::replace_substring(from_yaml, " ", "");
 
-                        if (from_yaml == from_scheme)
-                        {
-                            if ((split[0] == "(string=integer)") || (split[0] == "(string_remove_whitespaces=integer)"))
-                                yaml_data[key_ptr] = std::stoi(norm_pair[2]);
+                    // use lower casing for comparison
+                    ecb::yj_common::to_lower(from_yaml);
+                    ecb::yj_common::to_lower(from_scheme);
+
+                    if (from_yaml == from_scheme)
+                    {
+                        if ((rule.conversion == "(string=integer)")
+                            || (rule.conversion == "(string_remove_whitespaces=integer)"))
+                            yaml_data[key_ptr] = std::stoi(norm_pair.second);
 
-                            if (split[0] == "(string=string)")
-                                yaml_data[key_ptr] = norm_pair[2];
+                        if (rule.conversion == "(string=string)")
+                            yaml_data[key_ptr] = norm_pair.second;
 
-                            if ((split[0] == "(string=boolean)") && ((norm_pair[2] == "true") || (norm_pair[2] == "True")))
-                                yaml_data[key_ptr] = true;
+                        if ((rule.conversion == "(string=boolean)")
+                            && ((norm_pair.second == "true") || (norm_pair.second == "True")))
+                            yaml_data[key_ptr] = true;
 
-                            if ((split[0] == "(string=boolean)") && ((norm_pair[2] == "false") || (norm_pair[2] == "False")))
-                                yaml_data[key_ptr] = false;
+                        if ((rule.conversion == "(string=boolean)")
+                            && ((norm_pair.second == "false") || (norm_pair.second == "False")))
+                            yaml_data[key_ptr] = false;
 
-                            break;
-                        }
+                        break;
                     }
                 }
+            }
 
-                // normalize (integer=boolean)
-                if ((split[0] == "(integer=boolean)") && yaml_data[key_ptr].is_number_integer())
+            // normalize (integer=boolean)
+            if ((rule.conversion == "(integer=boolean)") && yaml_data[key_ptr].is_number_integer())
+            {
+                for (const auto& norm_pair : rule.values)
                 {
-                    for (auto norm_values = std::next(split.cbegin()) ; norm_values != split.cend();
-                        ++norm_values)
-                    {
-                        std::smatch norm_pair;
-                        std::regex_search(*norm_values, norm_pair, REGEX_norm_pair);
+                    int from_yaml = yaml_data[key_ptr];
+                    int from_scheme = std::stoi(norm_pair.first);
 
-                        int from_yaml = yaml_data[key_ptr];
-                        std::string from_scheme_str = norm_pair[1];
-                        int from_scheme = std::stoi(norm_pair[1]);
-
-                        if (from_yaml == from_scheme)
-                        {
-                            if ((split[0] == "(integer=boolean)") && ((norm_pair[2] == "true") || (norm_pair[2] == "True")))
-                                yaml_data[key_ptr] = true;
+                    if (from_yaml == from_scheme)
+                    {
+                        if ((norm_pair.second == "true") || (norm_pair.second == "True"))
+                            yaml_data[key_ptr] = true;
 
-                            if ((split[0] == "(integer=boolean)") && ((norm_pair[2] == "false") || (norm_pair[2] == "false")))
-                                yaml_data[key_ptr] = false;
+                        if (norm_pair.second == "false")
+                            yaml_data[key_ptr] = false;
 
-                            break;
-                        }
+                        break;
                     }
                 }
             }
@@ -146,43 +249,35 @@ ecb::YjSchema::normalize(json& yaml_data)
 void
 ecb::YjSchema::check_min_max_ranges(nlohmann::json& json)
 {
-    for (const auto& schema_entry : schema_.items())
+    check_min_max_ranges(json, collect_keys(json));
+}
+
+void
+ecb::YjSchema::check_min_max_ranges(nlohmann::json& json, const YjConfigKeys& cfg_keys)
+{
+    YjProfileTimer timer("schema.check_min_max_ranges");
+
+    for (const auto* definition : cfg_keys.definitions)
     {
-        // check "min" range
-        if ((schema_entry.key().find("/min") == std::string::npos)
-            && schema_entry.key().find("/max") == std::string::npos)
+        const auto& key_ptr = definition->pointer;
+
+        if (json[key_ptr].is_number() == false)
             continue;
-        else
-        {
-            const bool isMax = (schema_entry.key().find("/max") != std::string::npos);
-            const std::string::size_type key_end = schema_entry.key().rfind("/");
-            const std::string::size_type key_start = schema_entry.key().rfind("/", key_end - 1);
-            const std::string key = schema_entry.key().substr(key_start + 1, key_end - key_start - 1);
-            const auto key_ptr = ecb::yj_common::generate_json_pointer(key);
 
-            if ((json.contains(key_ptr)) == false || (json[key_ptr].is_number() == false))
-                continue;
+        // max
+        if (definition->max && (json[key_ptr] > *definition->max))
+        {
+            snprintf(throw_msg, sizeof(throw_msg), "key: %s is greater than maximum value defined in schema",
+                definition->key.c_str());
+            throw std::runtime_error(throw_msg);
+        }
 
-            if (isMax == true)
-            {
-                // max
-                if (json[key_ptr] > schema_entry.value())
-                {
-                    snprintf(throw_msg, sizeof(throw_msg), "key: %s is greater than maximum value defined in schema",
-                        key.c_str());
-                    throw std::runtime_error(throw_msg);
-                }
-            }
-            else
-            {
-                // min
-                if (json[key_ptr] < schema_entry.value())
-                {
-                    snprintf(throw_msg, sizeof(throw_msg), "key: %s is less than minimum value defined in schema",
-                        key.c_str());
-                    throw std::runtime_error(throw_msg);
-                }
-            }
+        // min
+        if (definition->min && (json[key_ptr] < *definition->min))
+        {
+            snprintf(throw_msg, sizeof(throw_msg), "key: %s is less than minimum value defined in schema",
+                definition->key.c_str());
+            throw std::runtime_error(throw_msg);
         }
     }
 }
@@ -190,38 +285,121 @@ ecb::YjSchema::check_min_max_ranges(nlohmann::json& json)
 void
 ecb::YjSchema::remove_undefined_keys(nlohmann::json& cfg_data)
 {
-    auto flatten_cfg_data = cfg_data.flatten();
-    nlohmann::json clean_cfg;
+    remove_undefined_keys(cfg_data, collect_keys(cfg_data));
+}
+
+std::vector<std::string>
+ecb::YjSchema::remove_undefined_keys(nlohmann::json& cfg_data, const YjConfigKeys& cfg_keys)
+{
+    YjProfileTimer timer("schema.remove_undefined_keys");
+
+    std::vector<std::string> ret_val;
+
+    // prefix identifiers of the used schemas
+    std::vector<std::string> prefixes;
+
+    for (const auto& used_schema : used_schemas_)
+    {
+        const std::string* identifier = schema_->get_identifier(used_schema);
+
+        if (identifier == nullptr)
+            throw std::runtime_error("unknown schema in schema file: " + used_schema);
+
+        prefixes.push_back(ecb::yj_common::cfg_key_to_json_key_string(*identifier));
+    }
 
     // check each key of cfg_data if it is covered by the schema
-    for (const auto& cfg_entry : flatten_cfg_data.items())
+    for (const auto& cfg_key : cfg_keys.keys.get_leaves())
     {
         bool is_defined = false;
 
-        for (const auto& used_schema : used_schemas_)
+        for (const auto& prefix : prefixes)
         {
-            // get prefix identifier from schema
-            std::string id = "/";
-            id += used_schema;
-            id += "/identifier";
-            const std::string prefix = ecb::yj_common::cfg_key_to_json_key_string(schema_[id]);
-
-            if (cfg_entry.key().find(prefix) != std::string::npos)
+            if (cfg_key.find(prefix) != std::string::npos)
             {
                 is_defined = true;
                 break;
             }
         }
 
-        if (is_defined == true)
-            clean_cfg[cfg_entry.key()] = cfg_entry.value();
-        else
+        if (is_defined == false)
+        {
             ecb::yj_common::log("warning: key is not specified in schema; value will be ignored: " +
-                cfg_entry.key());
+                cfg_key);
+            ret_val.push_back(cfg_key);
+        }
     }
 
-    clean_cfg = clean_cfg.unflatten();
-    cfg_data = std::move(clean_cfg);
+    const std::unordered_set<std::string> removed_keys(ret_val.begin(), ret_val.end());
+    std::string path;
+
+    // The keys are removed in place instead of copying the defined keys into
+    // a new configuration, so nothing is allocated if all keys are defined.
+    // Like `flatten()` and `unflatten()` before, empty lists and objects
+    // become null, objects and lists without remaining keys are removed and
+    // removed list items that are followed by others become null. The lambda
+    // returns false if `node` has to be removed.
+    auto remove_node = [&](nlohmann::json& node, auto& remove_children) -> bool
+    {
+        if (!node.is_structured() || node.empty())
+        {
+            if (node.is_structured())
+                node = nullptr;
+
+            return removed_keys.empty() || (removed_keys.count(path) == 0);
+        }
+
+        const size_t path_length = path.size();
+
+        if (node.is_object())
+        {
+            for (auto it = node.begin(); it != node.end();)
+            {
+                path += '/';
+
+                // escape the key like nlohmann::json::json_pointer does
+                for (const char c : it.key())
+                {
+                    if (c == '~')
+                        path += "~0";
+                    else if (c == '/')
+                        path += "~1";
+                    else
+                        path += c;
+                }
+
+                const bool is_kept = remove_children(it.value(), remove_children);
+                path.resize(path_length);
+                it = is_kept ? std::next(it) : node.erase(it);
+            }
+        }
+        else
+        {
+            size_t size = 0;
+
+            for (size_t i = 0; i < node.size(); ++i)
+            {
+                path += '/';
+                path += std::to_string(i);
+
+                if (remove_children(node[i], remove_children))
+                    size = i + 1;
+                else
+                    node[i] = nullptr;
+
+                path.resize(path_length);
+            }
+
+            node.erase(node.begin() + size, node.end());
+        }
+
+        return !node.empty();
+    };
+
+    if (!remove_node(cfg_data, remove_node))
+        cfg_data = nlohmann::json::object();
+
+    return ret_val;
 }
 
 
@@ -230,17 +408,10 @@ ecb::YjSchema::add_default_value_from_key(
     nlohmann::json& cfg_data,
     const std::string& key)
 {
-    std::string find_key = "/schema/" + key + "/default";
-
-    for (const auto& schema_entry : schema_.items())
+    for (const auto* definition : schema_->find_key(key))
     {
-        if (std::regex_search(schema_entry.key(), std::regex(find_key)))
-        {
-            const auto cfg_key = ecb::yj_common::generate_json_pointer(key);
-
-            if (cfg_data.contains(cfg_key) == false)
-                cfg_data[cfg_key] = schema_entry.value();
-        }
+        if (definition->default_value && (cfg_data.contains(definition->pointer) == false))
+            cfg_data[definition->pointer] = *definition->default_value;
     }
 }
 
@@ -248,35 +419,34 @@ void
 ecb::YjSchema::add_schema_default_values(
     nlohmann::json& cfg_data)
 {
+    auto cfg_keys = collect_keys(cfg_data);
+    add_schema_default_values(cfg_data, cfg_keys);
+}
+
+void
+ecb::YjSchema::add_schema_default_values(
+    nlohmann::json& cfg_data, YjConfigKeys& cfg_keys)
+{
+    YjProfileTimer timer("schema.add_schema_default_values");
+
     fetch_list_of_schemas(grand_schema_, cfg_data);
 
     for (const auto& schema : all_schemas_)
     {
-        if ((schema.second == true) || is_subschema_defined(schema.first, cfg_data))
+        if ((schema.second == true) || is_subschema_defined(schema.first, cfg_keys))
         {
-            std::string identifier_key = schema.first + ".identifier";
-            auto key = ecb::yj_common::cfg_key_to_json_key_string(identifier_key);
-
-            std::string key_prefix = "";
-
-            if (schema_.contains(key))
-                key_prefix = schema_[key];
+            const std::string* identifier = schema_->get_identifier(schema.first);
+            const std::string key_prefix = (identifier == nullptr) ? "" : *identifier;
 
-            for (const auto& schema_entry : schema_.items())
+            for (const auto* definition : schema_->get_schema_keys(schema.first))
             {
-                if (schema_entry.key().find(key_prefix) != std::string::npos)
-                {
-                    std::smatch match;
-
-                    std::string find_key = schema.first + "/schema/(" + key_prefix + ".*)" + "/default";
-
-                    if (std::regex_search(schema_entry.key(), match, std::regex(find_key)))
-                    {
-                        const auto cfg_key = ecb::yj_common::generate_json_pointer(match[1].str());
+                if (!definition->default_value || (definition->key.rfind(key_prefix, 0) != 0))
+                    continue;
 
-                        if (cfg_data.contains(cfg_key) == false)
-                            cfg_data[cfg_key] = schema_entry.value();
-                    }
+                if (cfg_data.contains(definition->pointer) == false)
+                {
+                    cfg_data[definition->pointer] = *definition->default_value;
+                    add_key(definition->pointer.to_string(), cfg_data, cfg_keys);
                 }
             }
         }
@@ -287,98 +457,102 @@ void
 ecb::YjSchema::check_and_normalize_datatypes(
     nlohmann::json& cfg_data)
 {
-    for (const auto& schema_entry : schema_.items())
+    check_and_normalize_datatypes(cfg_data, collect_keys(cfg_data));
+}
+
+void
+ecb::YjSchema::check_and_normalize_datatypes(
+    nlohmann::json& cfg_data, const YjConfigKeys& cfg_keys)
+{
+    YjProfileTimer timer("schema.check_and_normalize_datatypes");
+
+    for (const auto* definition : cfg_keys.definitions)
     {
-        std::smatch match;
+        const auto& key = definition->pointer;
+        bool is_valid = false;
 
-        if (std::regex_search(schema_entry.key(), match,
-            std::regex(R"(/schema/(.*)/type)")))
+        for (const auto datatype : definition->datatypes)
         {
-            const auto key = ecb::yj_common::generate_json_pointer(match[1].str());
+            if (datatype == YjDatatype::STRING && cfg_data[key].is_string())
+                is_valid = true;
+
+            if (datatype == YjDatatype::INTEGER && (cfg_data[key].is_number_integer()
+                || cfg_data[key].is_number_unsigned()))
+                is_valid = true;
 
-            if (cfg_data.contains(key))
+            if (datatype == YjDatatype::BOOLEAN && cfg_data[key].is_boolean())
+                is_valid = true;
+
+            if (datatype == YjDatatype::BOOLEAN && cfg_data[key].is_string())
             {
-                bool is_valid = false;
-                const std::string value = schema_entry.value();
-                const auto valid_datatypes = ecb::yj_common::tokenize(
-                        value,
-                        ecb::yj_common::REGEX_token_sep_space);
+                std::string value = cfg_data[key].template get<std::string>();
+                ecb::yj_common::to_lower(value);
 
-                for (const auto& datatype : valid_datatypes)
+                if ((value == "true") || (value == "yes"))
                 {
-                    if (datatype == "string" && cfg_data[key].is_string())
-                        is_valid = true;
+                    cfg_data[key] = true;
+                    is_valid = true;
+                }
 
-                    if (datatype == "integer" && (cfg_data[key].is_number_integer()
-                        || cfg_data[key].is_number_unsigned()))
-                        is_valid = true;
+                if ((value == "false") || (value == "no"))
+                {
+                    cfg_data[key] = false;
+                    is_valid = true;
+                }
+            }
 
-                    if (datatype == "boolean" && cfg_data[key].is_boolean())
-                        is_valid = true;
+            if (datatype == YjDatatype::BOOLEAN && cfg_data[key].is_number_integer())
+            {
+                int value = cfg_data[key].template get<int>();
 
-                    if (datatype == "boolean" && cfg_data[key].is_string())
-                    {
-                        std::string value = cfg_data[key].template get<std::string>();
-                        ecb::yj_common::to_lower(value);
-
-                        if ((value == "true") || (value == "yes"))
-                        {
-                            cfg_data[key] = true;
-                            is_valid = true;
-                        }
-
-                        if ((value == "false") || (value == "no"))
-                        {
-                            cfg_data[key] = false;
-                            is_valid = true;
-                        }
-                    }
+                if (value == 1)
+                {
+                    cfg_data[key] = true;
+                    is_valid = true;
+                }
 
-                    if (datatype == "boolean" && cfg_data[key].is_number_integer())
-                    {
-                        int value = cfg_data[key].template get<int>();
-
-                        if (value == 1) 
-                        {
-                            cfg_data[key] = true;
-                            is_valid = true;
-                        }
-
-                        if (value == 0)
-                        {
-                            cfg_data[key] = false;
-                            is_valid = true;
-                        }
-                    }
+                if (value == 0)
+                {
+                    cfg_data[key] = false;
+                    is_valid = true;
+                }
+            }
 
-                    if (datatype == "float" && cfg_data[key].is_number_float())
-                        is_valid = true;
+            if (datatype == YjDatatype::FLOAT && cfg_data[key].is_number_float())
+                is_valid = true;
 
-                    if (datatype == "float" && cfg_data[key].is_number_integer())
-                    {
-                        double temp = cfg_data[key].template get<double>();
-                        cfg_data[key] = temp;
-                        is_valid = true;
-                    }
-
-                    if (datatype == "list" && cfg_data[key].is_array())
-                        is_valid = true;
+            if (datatype == YjDatatype::FLOAT && cfg_data[key].is_number_integer())
+            {
+                double temp = cfg_data[key].template get<double>();
+                cfg_data[key] = temp;
+                is_valid = true;
+            }
 
-                    if (is_valid == true)
-                        break;
-                }
+            if (datatype == YjDatatype::LIST && cfg_data[key].is_array())
+                is_valid = true;
 
-                if ((valid_datatypes.size() > 0) && (is_valid == false))
-                    throw std::runtime_error("key: " + key.to_string() + " is not of datatype: " +
-                        value);
-            }
+            if (is_valid == true)
+                break;
         }
+
+        if ((definition->datatypes.size() > 0) && (is_valid == false))
+            throw std::runtime_error("key: " + key.to_string() + " is not of datatype: " +
+                definition->type);
     }
 }
 
 void
 ecb::YjSchema::check_schema(const std::string& selected_schema, nlohmann::json& cfg_data)
 {
+    check_schema(selected_schema, cfg_data, collect_keys(cfg_data));
+}
+
+void
+ecb::YjSchema::check_schema(const std::string& selected_schema, nlohmann::json& cfg_data,
+    const YjConfigKeys& cfg_keys)
+{
+    YjProfileTimer timer("schema.check_schema");
+
     fetch_list_of_schemas(selected_schema, cfg_data);
 
     for (const auto& schema : all_schemas_)
@@ -387,13 +561,13 @@ ecb::YjSchema::check_schema(const std::string& selected_schema, nlohmann::json&
             continue;
 
         // is schema defined in schema file?
-        auto id_key = ecb::yj_common::cfg_key_to_json_key_string(schema.first + ".identifier");
+        const std::string* identifier = schema_->get_identifier(schema.first);
 
-        if (schema_.contains(id_key) == false)
+        if (identifier == nullptr)
             throw std::runtime_error("unknown schema in schema file: " + schema.first);
 
         // check if there are keys in cfg_data that start with schema.identifier
-        bool key_is_incomplete = is_incomplete_key(schema_[id_key], cfg_data);
+        bool key_is_incomplete = is_incomplete_key(*identifier, cfg_keys);
 
         bool is_required = schema.second;
 
@@ -409,7 +583,7 @@ ecb::YjSchema::check_schema(const std::string& selected_schema, nlohmann::json&
             }
             else
             {
-                if (is_subschema_defined(schema.first, cfg_data) == true)
+                if (is_subschema_defined(schema.first, cfg_keys) == true)
                 {
                     check_subschema(schema.first, cfg_data);
                     used_schemas_.push_back(schema.first);
@@ -422,62 +596,32 @@ ecb::YjSchema::check_schema(const std::string& selected_schema, nlohmann::json&
 void
 ecb::YjSchema::check_subschema(const std::string& subschema, nlohmann::json& cfg_data)
 {
-    for (const auto& schema : schema_.items())
+    for (const auto* definition : schema_->get_schema_keys(subschema))
     {
-        if (schema.key().find(subschema) == std::string::npos)
-            continue;
-
-        // check if keys with required=true exist
-        std::smatch match;
-
-        if ((schema.key().find("required") != std::string::npos))
+        // check dependencies
+        if (!definition->dependencies.empty() && cfg_data.contains(definition->pointer))
         {
-            const auto REGEX_find_required = std::regex("/" + subschema + R"(/schema/(.*)/required)");
-
-            if (std::regex_search(schema.key(), match, REGEX_find_required))
+            for (const auto& dependencies : definition->dependencies)
             {
-                if ((schema.value() == true))
+                for (const auto& dependency : dependencies.keys)
                 {
-                    const auto key = ecb::yj_common::generate_json_pointer(match[1].str());
+                    auto dep_key = ecb::yj_common::generate_json_pointer(dependency);
 
-                    if (cfg_data.contains(key) == false)
+                    if (cfg_data.contains(dep_key) == false)
                     {
-                        throw std::runtime_error("cannot find key: " + match[1].str() +
-                            " required by schema: "
-                            + subschema);
+                        throw std::runtime_error("missing key dependency: \"" + dependencies.name +
+                            "\" depends on \"" + dependency + "\"");
                     }
                 }
             }
         }
 
-        // check dependencies
-        if (schema.key().find("dependencies") != std::string::npos)
+        // check if keys with required=true exist
+        if (definition->required && (cfg_data.contains(definition->pointer) == false))
         {
-            const auto REGEX_find_dependencies = std::regex("/" + subschema + R"(/schema/(.*)/dependencies)");
-
-            if (std::regex_search(schema.key(), match, REGEX_find_dependencies))
-            {
-                const auto key = ecb::yj_common::generate_json_pointer(match[1].str());
-
-                if (cfg_data.contains(key))
-                {
-                    const auto dependencies = ecb::yj_common::tokenize(
-                            schema.value().template get<std::string>(),
-                            ecb::yj_common::REGEX_token_sep_space);
-
-                    for (const auto& dependency : dependencies)
-                    {
-                        auto dep_key = ecb::yj_common::generate_json_pointer(dependency);
-
-                        if (cfg_data.contains(dep_key) == false)
-                        {
-                            std::regex_search(schema.key(), match, std::regex(R"(/schema/(.*)/)"));
-                            throw std::runtime_error("missing key dependency: \"" + match[1].str() +
-                                "\" depends on \"" + dependency + "\"");
-                        }
-                    }
-                }
-            }
+            throw std::runtime_error("cannot find key: " + definition->key +
+                " required by schema: "
+                + subschema);
         }
     }
 }
@@ -486,160 +630,68 @@ void
 ecb::YjSchema::check_for_valid_keys(
     nlohmann::json& cfg_data)
 {
-    const auto flatten_cfg_data = cfg_data.flatten();
-    std::string actual_cfg_key;
-    std::string actual_schema_key;
-    std::vector<std::string> valid_subkeys;
-
-    // create a list of identifiers that shall be ignored due to
-    // allowAnySubkey = true
-    for (const auto& schema_entry : schema_.items())
-    {
-        if (schema_entry.key().find("/allowAnySubkey") != std::string::npos)
-        {
-            if (schema_entry.value() == true) // allowAnySubkey == true ?
-            {
-                // change /allowAnySubkey to /identifier
-                std::string id_key = schema_entry.key();
-                id_key.erase(id_key.size() - 14, id_key.size());
-                id_key += "identifier";
+    check_for_valid_keys(collect_keys(cfg_data));
+}
 
-                valid_subkeys.push_back(schema_[id_key]);
-            }
-        }
-    }
+void
+ecb::YjSchema::check_for_valid_keys(
+    const YjConfigKeys& cfg_keys)
+{
+    YjProfileTimer timer("schema.check_for_valid_keys");
 
-    // check key with schema
-    for (const auto& cfg_entry : flatten_cfg_data.items())
+    for (const auto& cfg_key : cfg_keys.keys.get_leaves())
     {
-        bool is_valid_key = false;
-
-        // skip keys that are ok because of allowAnySubkey = true
-        for (const auto& valid_subkey : valid_subkeys)
-        {
-            if (cfg_entry.key().find(valid_subkey) != std::string::npos)
-            {
-                is_valid_key = true;
-                break;
-            }
-        }
-
-        if (is_valid_key == true)
-            continue;
-
-        // check if key is defined somewhere in schema
-        for (const auto& schema_entry : schema_.items())
-        {
-            actual_schema_key = ecb::yj_common::cfg_key_to_json_key_string(schema_entry.key());
-            actual_cfg_key = "/schema" + cfg_entry.key();
-
-            // keys point to array elements end with /0, /1 ... remove this
-            auto pos_last_slash = actual_cfg_key.rfind("/");
-            std::string::iterator it = actual_cfg_key.begin();
-            std::advance(it, pos_last_slash + 1);
-
-            if ((pos_last_slash != std::string::npos) && std::any_of(it, actual_cfg_key.end(), ::isdigit))
-                actual_cfg_key.erase(it, actual_cfg_key.end());
-
-
-            if (actual_schema_key.find(actual_cfg_key) != std::string::npos)
-            {
-                is_valid_key = true;
-                break;
-            }
-        }
-
-        if (is_valid_key == false)
-            throw std::runtime_error("unknown key: " + cfg_entry.key());
+        if (!schema_->is_valid_key(cfg_key))
+            throw std::runtime_error("unknown key: " + cfg_key);
     }
 }
 
-std::string
-ecb::YjSchema::find_grand_schema_prefix(const std::string& selected_schema,
+const ecb::YjGrandSchemaCondition*
+ecb::YjSchema::find_grand_schema_condition(const std::string& selected_schema,
     nlohmann::json& cfg_data)
 {
-    std::string ret_val;
-    std::smatch condition_key_value;
-    std::smatch prefix_and_condition;
-
-    for (const auto& schema : schema_.items())
+    for (const auto& condition : schema_->get_grand_schema_conditions(selected_schema))
     {
-        const std::string rege = R"(^(\/grandSchema\/)" + selected_schema + R"(\/(.*)\/)(.*))";
-        const auto REGEX_find_prefix_and_condition = std::regex(rege);
+        // condition.prefix = /grandSchema/axis/axis.abc=0/
+        // condition.pointer = /axis/abc, condition.value = 0
+        const auto& key = condition.pointer;
 
-        if (std::regex_search(schema.key(), prefix_and_condition,
-            REGEX_find_prefix_and_condition))
+        if (cfg_data.contains(key) == true)
         {
-            // prefix_and_condition[1] = /grandSchema/axis/axis.abc=0/ -> prefix
-            // prefix_and_condition[2] = axis.type=0 -> condition
-            const std::string condition = prefix_and_condition[2];
-
-
-            if (std::regex_search(condition, condition_key_value, std::regex(R"((.+)=(.+))")))
-            {
-                // condition_key_value[1] = axis.type -> key
-                // condition_key_value[2] = 0 -> value
-                const auto key = ecb::yj_common::generate_json_pointer(condition_key_value[1]);
+            if (cfg_data[key].is_number_integer()
+                && ((std::to_string(cfg_data[key].template get<int>()) == condition.value)))
+                return &condition;
 
-                if (cfg_data.contains(key) == true)
-                {
-                    if (cfg_data[key].is_number_integer()
-                        && ((std::to_string(cfg_data[key].template get<int>()) == condition_key_value[2])))
-                    {
-                        ret_val = prefix_and_condition[1];
-                        break;
-                    }
-
-                    if (cfg_data[key] == condition_key_value[2])
-                    {
-                        ret_val = prefix_and_condition[1];
-                        break;
-                    }
-                }
-            }
+            if (cfg_data[key] == condition.value)
+                return &condition;
         }
     }
 
-    return ret_val;
+    return nullptr;
 }
 
 bool
 ecb::YjSchema::is_incomplete_key(
     std::string identifier,
-    nlohmann::json& cfg_data)
+    const YjConfigKeys& cfg_keys)
 {
-    auto flatten_cfg_data = cfg_data.flatten();
-    std::string id = ecb::yj_common::cfg_key_to_json_key_string(identifier);
-    id += "/";
-
-    bool is_found = false;
-
-    for (const auto& cfg_entry : flatten_cfg_data.items())
-    {
-        if (cfg_entry.key().find(id) == 0)
-        {
-            is_found = true;
-            break;
-        }
-    }
-
-    return is_found;
+    return cfg_keys.keys.has_prefix(ecb::yj_common::cfg_key_to_json_key_string(identifier) + "/");
 }
 
 bool
-ecb::YjSchema::is_subschema_defined(const std::string& schema, nlohmann::json& cfg_data)
+ecb::YjSchema::is_subschema_defined(const std::string& schema, const YjConfigKeys& cfg_keys)
 {
     bool is_defined = false;
     std::string value;
 
     // check if schema is defined in schema file
-    auto id_key = ecb::yj_common::cfg_key_to_json_key_string(schema + ".identifier");
+    const std::string* identifier = schema_->get_identifier(schema);
 
-    if (schema_.contains(id_key) == false)
+    if (identifier == nullptr)
         throw std::runtime_error("unknown schema in schema file: " + schema);
 
-    value = schema_[id_key];
-    is_defined = is_incomplete_key(value, cfg_data);
+    value = *identifier;
+    is_defined = is_incomplete_key(value, cfg_keys);
 
     return is_defined;
 }
@@ -651,22 +703,18 @@ ecb::YjSchema::fetch_list_of_schemas(const std::string& grand_schema, nlohmann::
     {
         is_schemas_fetched_ = true;
 
-        std::string schema_key_prefix = find_grand_schema_prefix(grand_schema, cfg_data);
-        const std::string required_key = schema_key_prefix + "required";
-        const std::string optional_key = schema_key_prefix + "optional";
+        const auto* condition = find_grand_schema_condition(grand_schema, cfg_data);
 
         std::vector<std::string> required_schemas;
 
-        if (schema_.contains(required_key))
-            required_schemas = ecb::yj_common::tokenize(
-                    schema_[required_key].template get<std::string>(),
+        if ((condition != nullptr) && !condition->required.empty())
+            required_schemas = ecb::yj_common::tokenize(condition->required,
                     ecb::yj_common::REGEX_token_sep_space);
 
         std::vector<std::string> optional_schemas;
 
-        if (schema_.contains(optional_key))
-            optional_schemas = ecb::yj_common::tokenize(
-                    schema_[optional_key].template get<std::string>(),
+        if ((condition != nullptr) && !condition->optional.empty())
+            optional_schemas = ecb::yj_common::tokenize(condition->optional,
                     ecb::yj_common::REGEX_token_sep_space);
 
         all_schemas_.reserve(required_schemas.size() + optional_schemas.size());
@@ -20,11 +20,46 @@
 #define _YJ_SCHEMA_H_
 
 #include <istream>
+#include <memory>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <vector>
+
+#include "yj_key_index.h"
+#include "yj_schema_index.h"
 
 namespace ecb
 {
+// Keys of a configuration, collected by one walk through the configuration
+// and kept up to date while keys are added during the validation.
+struct YjConfigKeys
+{
+    YjKeyIndex keys;
+
+    // schema definitions of the nodes in `keys`, in the order of the schema
+    // file
+    std::vector<const YjKeyDefinition*> definitions;
+};
+
+
+// Result of `YjSchema::validate`.
+struct YjValidationResult
+{
+    // schemas used by the configuration, see `check_schema`
+    std::vector<std::string> used_schemas;
+
+    // keys removed from the configuration, see `remove_undefined_keys`
+    std::vector<std::string> removed_keys;
+
+    // number of keys (values without children) of the validated
+    // configuration
+    size_t key_count = 0;
+
+    // keys of the validated configuration, e.g. for `YjRender::render`
+    YjKeyIndex keys;
+};
+
+
 class YjSchema
 {
 public:
@@ -39,6 +74,49 @@ public:
         std::string filename_schema,
         const std::string& selected_schema);
 
+    // Initializes the object with a schema returned by `load_schema`. The
+    // schema is not copied, so many objects can share the same schema.
+    YjSchema(
+        std::shared_ptr<const YjSchemaIndex> schema,
+        const std::string& selected_schema);
+
+
+    // Reads the schema provided in `schema` or `filename_schema` and
+    // compiles it into an index (see `YjSchemaIndex`). `filename_schema` may
+    // also be a binary schema (see `YjSchemaIndex::to_binary`), whose tables
+    // are decoded from the mapped file (see `YjSchemaIndex::from_binary`)
+    // instead of parsing and compiling the schema again. Throws an exception
+    // if the schema file cannot be read.
+    static std::shared_ptr<const YjSchemaIndex> load_schema(
+        std::istream& schema);
+
+    static std::shared_ptr<const YjSchemaIndex> load_schema(
+        const std::string& filename_schema);
+
+    // Same as above, the state of the schema file as it was read (see
+    // `yj_common::get_file_state`) is stored in `file_state`.
+    static std::shared_ptr<const YjSchemaIndex> load_schema(
+        const std::string& filename_schema,
+        nlohmann::json& file_state);
+
+
+    // Validates and completes `cfg_data` for the selected schema. This runs
+    // all steps in the order needed by the templates:
+    //
+    //   1. pre-evaluation of `axis.type` or `meta.schemaNumber`
+    //   2. `normalize`
+    //   3. `add_schema_default_values`
+    //   4. `check_and_normalize_datatypes` followed by `normalize`
+    //   5. `check_min_max_ranges`
+    //   6. `check_schema` and `check_for_valid_keys`
+    //   7. `remove_undefined_keys`
+    //
+    // The configuration is walked only once, all steps work on the keys
+    // collected by this walk. Throws an exception with the same message as
+    // the individual functions if a check fails.
+    YjValidationResult validate(
+        nlohmann::json& cfg_data);
+
 
     // This function adds the default value for `key` to `cfg_data`, but only
     // if the following conditions are met:
@@ -83,6 +161,7 @@ public:
     // not defined, this function throws an exception. Keys which are covered
     // by `allowAnySubkey=true` are ignored.  If all keys are defined in the
     // schema, this function just returns without throwing an exception.
+    // Array indices in the keys are ignored, see `YjSchemaIndex::is_valid_key`.
     void check_for_valid_keys(
         nlohmann::json& cfg_data);
 
@@ -119,8 +198,12 @@ public:
     // virtual, then the drive section is removed from the configurtation.
     //
     // Remarks:
-    //   - This function does not update the existing `cfg_data`. Instead
-    //     it creates a new json object and moves it to `cfg_data`.
+    //   - The undefined keys are erased from `cfg_data` in place; nothing is
+    //     copied if all keys are defined.
+    //   - Empty lists and objects become null, lists and objects without
+    //     remaining keys are removed and removed list items that are
+    //     followed by other items become null, so the indices don't change.
+    //     If no key remains at all, `cfg_data` becomes an empty object.
     //   - `check_schema()` must be called before calling this function.
     //
     void remove_undefined_keys(nlohmann::json& cfg_data);
@@ -128,13 +211,57 @@ public:
 
 private:
     bool is_schemas_fetched_;
-    nlohmann::json schema_;
+    std::shared_ptr<const YjSchemaIndex> schema_;
     std::string grand_schema_;
     std::vector<std::pair<std::string, bool>> all_schemas_;
     std::vector<std::string> used_schemas_;
     char throw_msg[350];
 
-    // Checks if the given key is an incomplete key in `cfg_data`. Returns true of the key is
+    // Walks through `cfg_data` and returns all its keys.
+    YjConfigKeys collect_keys(
+        const nlohmann::json& cfg_data);
+
+
+    // Adds `key` (format "/a/b/c") and its parents to `cfg_keys` after the
+    // value of `key` was set in `cfg_data`.
+    void add_key(
+        const std::string& key,
+        const nlohmann::json& cfg_data,
+        YjConfigKeys& cfg_keys);
+
+
+    // Implementations of the public functions with the same name. They use
+    // the keys in `cfg_keys` instead of walking through `cfg_data`.
+    void normalize(
+        nlohmann::json& cfg_data,
+        const YjConfigKeys& cfg_keys);
+
+    void add_schema_default_values(
+        nlohmann::json& cfg_data,
+        YjConfigKeys& cfg_keys);
+
+    void check_and_normalize_datatypes(
+        nlohmann::json& cfg_data,
+        const YjConfigKeys& cfg_keys);
+
+    void check_min_max_ranges(
+        nlohmann::json& cfg_data,
+        const YjConfigKeys& cfg_keys);
+
+    void check_schema(
+        const std::string& selected_schema,
+        nlohmann::json& cfg_data,
+        const YjConfigKeys& cfg_keys);
+
+    void check_for_valid_keys(
+        const YjConfigKeys& cfg_keys);
+
+    std::vector<std::string> remove_undefined_keys(
+        nlohmann::json& cfg_data,
+        const YjConfigKeys& cfg_keys);
+
+
+    // Checks if the given key is an incomplete key in `cfg_keys`. Returns true of the key is
     // incomplete, otherwise false. An incomplete key is a key that can have
     // more levels added. Only more levels are allowed at the end and not at
     // the beginning of the key.
@@ -147,7 +274,7 @@ private:
     //    is_complete_key(a.b.c", X) -> false
     bool is_incomplete_key(
         std::string identifier,
-        nlohmann::json& cfg_data);
+        const YjConfigKeys& cfg_keys);
 
 
     // Checks if the given schema is present in schema file and if the
@@ -155,24 +282,18 @@ private:
     // otherwise false.
     bool is_subschema_defined(
         const std::string& schema,
-        nlohmann::json& cfg_data);
+        const YjConfigKeys& cfg_keys);
 
 
-    // Returns the prefix of the key for the selected grand schema if:
-    //
-    //     1. the prefix exists in the schema file
-    //     2. the key's condition is true
-    //
-    // An empty string is returned if either of the conditions is not true,
-    // otherwise, returns the prefix in the format:
-    // `/grandSchema/selected_schema/condition`. The condition is defined
-    // as `key=value` where both values are in `cfg_data`
+    // Returns the condition of the selected grand schema that is true for
+    // `cfg_data`, or nullptr if no condition is true. The condition is
+    // defined as `key=value` in the schema file.
     //
     // Example:
     //     `selected_schema` shall be `axis` and the condition is `axis.type=1`.
-    //     Then `/grandSchema/axis/axis.type=1/ is returned, but only if `cfg_data`
-    //     contains a key `axis.type` with the value 1.
-    std::string find_grand_schema_prefix(
+    //     Then the condition `/grandSchema/axis/axis.type=1/` is returned, but
+    //     only if `cfg_data` contains a key `axis.type` with the value 1.
+    const YjGrandSchemaCondition* find_grand_schema_condition(
         const std::string& selected_schema,
         nlohmann::json& cfg_data);
 
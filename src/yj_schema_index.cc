@@ -0,0 +1,621 @@
+//
+// ECB - compiled index of a schema file
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+
+#include "yj_common.h"
+#include "yj_profile.h"
+#include "yj_schema_index.h"
+
+using nlohmann::json;
+
+// first bytes of a binary schema, a JSON schema file cannot start with them
+static const std::string_view binary_signature("ECBSCHM", 8);
+
+
+// Appends `value` to the binary schema `binary`. Numbers are written in
+// little endian byte order on every machine, strings and JSON values are
+// prefixed with their size and JSON values are encoded as CBOR.
+static void
+write_u32(std::string& binary, uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+        binary += static_cast<char>((value >> shift) & 0xff);
+}
+
+static void
+write_string(std::string& binary, const std::string& value)
+{
+    write_u32(binary, value.size());
+    binary.append(value);
+}
+
+static void
+write_json(std::string& binary, const std::optional<json>& value)
+{
+    write_u32(binary, value.has_value() ? 1 : 0);
+
+    if (value.has_value())
+    {
+        const auto cbor = json::to_cbor(*value);
+        write_u32(binary, cbor.size());
+        binary.append(reinterpret_cast<const char*>(cbor.data()), cbor.size());
+    }
+}
+
+
+// Reads the values written by the `write_*` functions from a binary schema.
+// Throws an exception if the binary schema ends too early.
+class YjBinaryReader
+{
+public:
+    explicit YjBinaryReader(std::string_view binary)
+        : binary_(binary)
+    {
+    }
+
+    std::string_view
+    read_bytes(size_t count)
+    {
+        if (count > binary_.size() - position_)
+            throw std::runtime_error("binary schema is damaged");
+
+        const auto ret_val = binary_.substr(position_, count);
+        position_ += count;
+
+        return ret_val;
+    }
+
+    uint32_t
+    read_u32()
+    {
+        const auto bytes = read_bytes(4);
+        uint32_t ret_val = 0;
+
+        for (int i = 3; i >= 0; --i)
+            ret_val = (ret_val << 8) | static_cast<unsigned char>(bytes[i]);
+
+        return ret_val;
+    }
+
+    // number of elements of a list, each element takes at least one byte
+    uint32_t
+    read_count()
+    {
+        const uint32_t ret_val = read_u32();
+
+        if (ret_val > binary_.size() - position_)
+            throw std::runtime_error("binary schema is damaged");
+
+        return ret_val;
+    }
+
+    std::string
+    read_string()
+    {
+        return std::string(read_bytes(read_u32()));
+    }
+
+    std::optional<json>
+    read_json()
+    {
+        if (read_u32() == 0)
+            return std::nullopt;
+
+        const auto cbor = read_bytes(read_u32());
+        return json::from_cbor(cbor.begin(), cbor.end());
+    }
+
+    bool
+    is_at_end() const
+    {
+        return position_ == binary_.size();
+    }
+
+private:
+    std::string_view binary_;
+    size_t position_ = 0;
+};
+
+
+ecb::YjSchemaIndex::YjSchemaIndex(const nlohmann::json& flat_schema)
+{
+    // schemas with `allowAnySubkey=true`, their identifiers may follow later
+    std::vector<std::string> any_subkey_schemas;
+
+    for (const auto& entry : flat_schema.items())
+    {
+        const std::string& flat_key = entry.key();
+
+        // "/axisSchema/schema/axis.type/default" -> axisSchema, schema, ...
+        std::vector<std::string> segments;
+
+        for (size_t start = 1, end = 0; start <= flat_key.size(); start = end + 1)
+        {
+            end = flat_key.find('/', start);
+
+            if (end == std::string::npos)
+                end = flat_key.size();
+
+            segments.push_back(flat_key.substr(start, end - start));
+        }
+
+        if (segments.size() < 2)
+            continue;
+
+        if ((segments.size() == 2) && (segments[1] == "identifier"))
+        {
+            if (entry.value().is_string())
+                identifiers_[segments[0]] = entry.value().get<std::string>();
+
+            continue;
+        }
+
+        if ((segments.size() == 2) && (segments[1] == "allowAnySubkey"))
+        {
+            if (entry.value() == true)
+                any_subkey_schemas.push_back(segments[0]);
+
+            continue;
+        }
+
+        // /grandSchema/axis/axis.type=1/required
+        if ((segments[0] == "grandSchema") && (segments.size() >= 4))
+        {
+            const std::string::size_type prefix_end = flat_key.rfind('/') + 1;
+            const std::string::size_type condition_start = segments[0].size() + segments[1].size() + 3;
+
+            if (prefix_end <= condition_start)
+                continue;
+
+            const std::string condition = flat_key.substr(condition_start, prefix_end - condition_start - 1);
+            const std::string::size_type equal_sign = (condition.size() < 3) ? std::string::npos :
+                condition.rfind('=', condition.size() - 2);
+
+            if ((equal_sign == std::string::npos) || (equal_sign == 0))
+                continue;
+
+            auto& conditions = grand_schemas_[segments[1]];
+            const std::string prefix = flat_key.substr(0, prefix_end);
+
+            if (conditions.empty() || (conditions.back().prefix != prefix))
+            {
+                conditions.push_back({prefix,
+                    ecb::yj_common::generate_json_pointer(condition.substr(0, equal_sign)),
+                    condition.substr(equal_sign + 1), "", ""});
+            }
+
+            if ((segments.size() == 4) && entry.value().is_string())
+            {
+                if (segments[3] == "required")
+                    conditions.back().required = entry.value().get<std::string>();
+                else if (segments[3] == "optional")
+                    conditions.back().optional = entry.value().get<std::string>();
+            }
+
+            continue;
+        }
+
+        // /axisSchema/schema/axis.type/default
+        if ((segments.size() >= 4) && (segments[1] == "schema") && !segments[2].empty())
+            add_attribute(segments[0], segments[2], segments[3], (segments.size() > 4), flat_key,
+                entry.value());
+    }
+
+    for (const auto& schema : any_subkey_schemas)
+    {
+        if (const auto* identifier = get_identifier(schema); (identifier != nullptr) && !identifier->empty())
+            any_subkey_prefixes_.insert(ecb::yj_common::cfg_key_to_json_key_string(*identifier));
+    }
+
+    index_definitions();
+}
+
+void
+ecb::YjSchemaIndex::index_definitions()
+{
+    for (size_t i = 0; i < definitions_.size(); ++i)
+    {
+        keys_[definitions_[i].pointer.to_string()].push_back(i);
+
+        if (auto it = schemas_.find(definitions_[i].schema); it != schemas_.end())
+            it->second.second = i + 1;
+        else
+            schemas_.emplace(definitions_[i].schema, std::make_pair(i, i + 1));
+    }
+
+    // a key and all its parents, e.g. "/a/b/c", "/a/b" and "/a"
+    for (const auto& key : keys_)
+    {
+        for (size_t end = key.first.size(); (end != std::string::npos) && (end != 0);
+            end = key.first.rfind('/', end - 1))
+        {
+            if (!valid_keys_.insert(key.first.substr(0, end)).second)
+                break;
+        }
+    }
+}
+
+void
+ecb::YjSchemaIndex::add_attribute(
+    const std::string& schema, const std::string& key, const std::string& attribute,
+    bool is_element, const std::string& flat_key, const nlohmann::json& value)
+{
+    // all attributes of a key are next to each other in the flattened schema
+    if (definitions_.empty() || (definitions_.back().schema != schema) || (definitions_.back().key != key))
+    {
+        YjKeyDefinition definition;
+        definition.schema = schema;
+        definition.key = key;
+        definition.pointer = ecb::yj_common::generate_json_pointer(key);
+        definitions_.push_back(std::move(definition));
+    }
+
+    auto& definition = definitions_.back();
+
+    if ((attribute == "type") && !is_element && value.is_string())
+    {
+        definition.type = value.get<std::string>();
+
+        for (const auto& datatype : ecb::yj_common::tokenize(definition.type,
+                ecb::yj_common::REGEX_token_sep_space))
+        {
+            if (datatype == "string")
+                definition.datatypes.push_back(YjDatatype::STRING);
+            else if (datatype == "integer")
+                definition.datatypes.push_back(YjDatatype::INTEGER);
+            else if (datatype == "boolean")
+                definition.datatypes.push_back(YjDatatype::BOOLEAN);
+            else if (datatype == "float")
+                definition.datatypes.push_back(YjDatatype::FLOAT);
+            else if (datatype == "list")
+                definition.datatypes.push_back(YjDatatype::LIST);
+            else
+                definition.datatypes.push_back(YjDatatype::UNKNOWN);
+        }
+    }
+    else if ((attribute == "min") && !is_element)
+        definition.min = value;
+    else if ((attribute == "max") && !is_element)
+        definition.max = value;
+    else if ((attribute == "default") && !definition.default_value)
+    {
+        // for lists and objects the first element is used
+        definition.default_value = value;
+    }
+    else if (attribute == "required")
+        definition.required = definition.required || (value == true);
+    else if ((attribute == "dependencies") && value.is_string())
+    {
+        // name is the part between "/schema/" and the last slash
+        const std::string::size_type name_start = flat_key.find("/schema/") + 8;
+        const std::string::size_type name_end = flat_key.rfind('/');
+
+        definition.dependencies.push_back({flat_key.substr(name_start, name_end - name_start),
+            ecb::yj_common::tokenize(value.get<std::string>(), ecb::yj_common::REGEX_token_sep_space)});
+    }
+    else if ((attribute == "normalize") && value.is_string())
+    {
+        const auto split = ecb::yj_common::tokenize(value.get<std::string>(),
+                ecb::yj_common::REGEX_token_sep_space);
+
+        if (split.size() < 2)
+            return;
+
+        YjNormalizeRule rule;
+        rule.conversion = split[0];
+
+        // "from=to", `from` ends at the first equal sign
+        for (auto pair = std::next(split.cbegin()); pair != split.cend(); ++pair)
+        {
+            const std::string::size_type equal_sign = pair->find('=', 1);
+
+            if ((equal_sign == std::string::npos) || (equal_sign + 1 >= pair->size()))
+                rule.values.emplace_back("", "");
+            else
+                rule.values.emplace_back(pair->substr(0, equal_sign), pair->substr(equal_sign + 1));
+        }
+
+        definition.normalize.push_back(std::move(rule));
+    }
+}
+
+void
+ecb::YjSchemaIndex::append_definitions(
+    const std::string& json_key, std::vector<const YjKeyDefinition*>& definitions) const
+{
+    if (auto it = keys_.find(json_key); it != keys_.end())
+    {
+        yj_profile::count("schema_entries_scanned", it->second.size());
+
+        for (const auto index : it->second)
+            definitions.push_back(&definitions_[index]);
+    }
+}
+
+std::vector<const ecb::YjKeyDefinition*>
+ecb::YjSchemaIndex::find_key(const std::string& key) const
+{
+    std::vector<const YjKeyDefinition*> ret_val;
+
+    if (key.empty())
+        return ret_val;
+
+    if (auto it = keys_.find(ecb::yj_common::generate_json_pointer(key).to_string()); it != keys_.end())
+    {
+        yj_profile::count("schema_entries_scanned", it->second.size());
+
+        for (const auto index : it->second)
+            ret_val.push_back(&definitions_[index]);
+    }
+
+    return ret_val;
+}
+
+std::vector<const ecb::YjKeyDefinition*>
+ecb::YjSchemaIndex::get_schema_keys(const std::string& schema) const
+{
+    std::vector<const YjKeyDefinition*> ret_val;
+
+    if (auto it = schemas_.find(schema); it != schemas_.end())
+    {
+        yj_profile::count("schema_entries_scanned", it->second.second - it->second.first);
+
+        for (size_t i = it->second.first; i < it->second.second; ++i)
+            ret_val.push_back(&definitions_[i]);
+    }
+
+    return ret_val;
+}
+
+const std::string*
+ecb::YjSchemaIndex::get_identifier(const std::string& schema) const
+{
+    if (auto it = identifiers_.find(schema); it != identifiers_.end())
+        return &it->second;
+
+    return nullptr;
+}
+
+bool
+ecb::YjSchemaIndex::is_valid_key(const std::string& json_key) const
+{
+    // the key without array indices, e.g. "/a/0/b/1" -> "/a/b"
+    std::string key;
+    key.reserve(json_key.size());
+
+    for (size_t start = 1, end = 0; start <= json_key.size(); start = end + 1)
+    {
+        end = json_key.find('/', start);
+
+        if (end == std::string::npos)
+            end = json_key.size();
+
+        const bool is_index = (end > start) && std::all_of(json_key.begin() + start,
+                json_key.begin() + end, [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+
+        if (is_index)
+            continue;
+
+        key.append(json_key, start - 1, end - start + 1);
+
+        if (any_subkey_prefixes_.count(key) != 0)
+            return true;
+    }
+
+    return (valid_keys_.count(key) != 0);
+}
+
+const std::vector<ecb::YjGrandSchemaCondition>&
+ecb::YjSchemaIndex::get_grand_schema_conditions(const std::string& grand_schema) const
+{
+    static const std::vector<YjGrandSchemaCondition> no_conditions;
+
+    if (auto it = grand_schemas_.find(grand_schema); it != grand_schemas_.end())
+        return it->second;
+
+    return no_conditions;
+}
+
+std::string
+ecb::YjSchemaIndex::to_binary() const
+{
+    std::string ret_val(binary_signature);
+    write_u32(ret_val, ECB_SCHEMA_BINARY_VERSION);
+
+    write_u32(ret_val, definitions_.size());
+
+    for (const auto& definition : definitions_)
+    {
+        write_string(ret_val, definition.schema);
+        write_string(ret_val, definition.key);
+        write_string(ret_val, definition.type);
+
+        write_u32(ret_val, definition.datatypes.size());
+
+        for (const auto datatype : definition.datatypes)
+            write_u32(ret_val, static_cast<uint32_t>(datatype));
+
+        write_json(ret_val, definition.min);
+        write_json(ret_val, definition.max);
+        write_json(ret_val, definition.default_value);
+        write_u32(ret_val, definition.required ? 1 : 0);
+
+        write_u32(ret_val, definition.dependencies.size());
+
+        for (const auto& dependency : definition.dependencies)
+        {
+            write_string(ret_val, dependency.name);
+            write_u32(ret_val, dependency.keys.size());
+
+            for (const auto& key : dependency.keys)
+                write_string(ret_val, key);
+        }
+
+        write_u32(ret_val, definition.normalize.size());
+
+        for (const auto& rule : definition.normalize)
+        {
+            write_string(ret_val, rule.conversion);
+            write_u32(ret_val, rule.values.size());
+
+            for (const auto& value : rule.values)
+            {
+                write_string(ret_val, value.first);
+                write_string(ret_val, value.second);
+            }
+        }
+    }
+
+    // sorted, so the same schema always gives the same binary schema
+    const std::map<std::string, std::string> identifiers(identifiers_.begin(), identifiers_.end());
+    write_u32(ret_val, identifiers.size());
+
+    for (const auto& identifier : identifiers)
+    {
+        write_string(ret_val, identifier.first);
+        write_string(ret_val, identifier.second);
+    }
+
+    const std::set<std::string> any_subkey_prefixes(any_subkey_prefixes_.begin(),
+            any_subkey_prefixes_.end());
+    write_u32(ret_val, any_subkey_prefixes.size());
+
+    for (const auto& prefix : any_subkey_prefixes)
+        write_string(ret_val, prefix);
+
+    write_u32(ret_val, grand_schemas_.size());
+
+    for (const auto& grand_schema : grand_schemas_)
+    {
+        write_string(ret_val, grand_schema.first);
+        write_u32(ret_val, grand_schema.second.size());
+
+        for (const auto& condition : grand_schema.second)
+        {
+            write_string(ret_val, condition.prefix);
+            write_string(ret_val, condition.pointer.to_string());
+            write_string(ret_val, condition.value);
+            write_string(ret_val, condition.required);
+            write_string(ret_val, condition.optional);
+        }
+    }
+
+    return ret_val;
+}
+
+ecb::YjSchemaIndex
+ecb::YjSchemaIndex::from_binary(std::string_view binary)
+{
+    YjSchemaIndex ret_val;
+    YjBinaryReader reader(binary);
+
+    if (!is_binary(binary))
+        throw std::runtime_error("not a binary schema");
+
+    reader.read_bytes(binary_signature.size());
+
+    if (reader.read_u32() != ECB_SCHEMA_BINARY_VERSION)
+        throw std::runtime_error("binary schema has an incompatible version, compile it again");
+
+    ret_val.definitions_.resize(reader.read_count());
+
+    for (auto& definition : ret_val.definitions_)
+    {
+        definition.schema = reader.read_string();
+        definition.key = reader.read_string();
+        definition.pointer = ecb::yj_common::generate_json_pointer(definition.key);
+        definition.type = reader.read_string();
+
+        definition.datatypes.resize(reader.read_count());
+
+        for (auto& datatype : definition.datatypes)
+            datatype = static_cast<YjDatatype>(reader.read_u32());
+
+        definition.min = reader.read_json();
+        definition.max = reader.read_json();
+        definition.default_value = reader.read_json();
+        definition.required = (reader.read_u32() != 0);
+
+        definition.dependencies.resize(reader.read_count());
+
+        for (auto& dependency : definition.dependencies)
+        {
+            dependency.name = reader.read_string();
+            dependency.keys.resize(reader.read_count());
+
+            for (auto& key : dependency.keys)
+                key = reader.read_string();
+        }
+
+        definition.normalize.resize(reader.read_count());
+
+        for (auto& rule : definition.normalize)
+        {
+            rule.conversion = reader.read_string();
+            rule.values.resize(reader.read_count());
+
+            for (auto& value : rule.values)
+            {
+                value.first = reader.read_string();
+                value.second = reader.read_string();
+            }
+        }
+    }
+
+    for (uint32_t count = reader.read_count(); count > 0; --count)
+    {
+        std::string schema = reader.read_string();
+        ret_val.identifiers_[schema] = reader.read_string();
+    }
+
+    for (uint32_t count = reader.read_count(); count > 0; --count)
+        ret_val.any_subkey_prefixes_.insert(reader.read_string());
+
+    for (uint32_t count = reader.read_count(); count > 0; --count)
+    {
+        auto& conditions = ret_val.grand_schemas_[reader.read_string()];
+        conditions.resize(reader.read_count());
+
+        for (auto& condition : conditions)
+        {
+            condition.prefix = reader.read_string();
+            condition.pointer = json::json_pointer(reader.read_string());
+            condition.value = reader.read_string();
+            condition.required = reader.read_string();
+            condition.optional = reader.read_string();
+        }
+    }
+
+    if (!reader.is_at_end())
+        throw std::runtime_error("binary schema is damaged");
+
+    ret_val.index_definitions();
+
+    return ret_val;
+}
+
+bool
+ecb::YjSchemaIndex::is_binary(std::string_view content)
+{
+    return content.substr(0, binary_signature.size()) == binary_signature;
+}
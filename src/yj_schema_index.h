@@ -0,0 +1,225 @@
+//
+// ECB - compiled index of a schema file
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _YJ_SCHEMA_INDEX_H_
+#define _YJ_SCHEMA_INDEX_H_
+
+#include <map>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// version of the binary schema format, see `YjSchemaIndex::to_binary`
+#define ECB_SCHEMA_BINARY_VERSION 2
+
+namespace ecb
+{
+// Datatypes that can be used for `type` in the schema file.
+enum class YjDatatype
+{
+    STRING,
+    INTEGER,
+    BOOLEAN,
+    FLOAT,
+    LIST,
+    UNKNOWN,
+};
+
+
+// One `normalize` entry of a key, e.g. "(string=integer) real=1 virtual=2".
+struct YjNormalizeRule
+{
+    // first token of the entry, e.g. "(string=integer)"
+    std::string conversion;
+
+    // value pairs in the order of the schema file, e.g. {"real", "1"}
+    std::vector<std::pair<std::string, std::string>> values;
+};
+
+
+// One `dependencies` entry of a key.
+struct YjDependency
+{
+    // name of the key as used in error messages
+    std::string name;
+
+    // keys that must be defined if the key is defined
+    std::vector<std::string> keys;
+};
+
+
+// Definition of a key in one schema, e.g. `axis.type` in `axisSchema`.
+struct YjKeyDefinition
+{
+    // schema the key is defined in, e.g. "axisSchema"
+    std::string schema;
+
+    // key in the format "a.b.c" and as JSON pointer "/a/b/c"
+    std::string key;
+    nlohmann::json::json_pointer pointer;
+
+    // `type` as written in the schema file and the datatypes it lists. The
+    // order is kept, because the first matching datatype is used to convert
+    // the value.
+    std::string type;
+    std::vector<YjDatatype> datatypes;
+
+    std::optional<nlohmann::json> min;
+    std::optional<nlohmann::json> max;
+    std::optional<nlohmann::json> default_value;
+    bool required = false;
+    std::vector<YjDependency> dependencies;
+    std::vector<YjNormalizeRule> normalize;
+};
+
+
+// A condition of a grand schema, e.g. `axis.type=1` for `axis`.
+struct YjGrandSchemaCondition
+{
+    // prefix of the keys `required` and `optional` in the flattened schema,
+    // e.g. "/grandSchema/axis/axis.type=1/"
+    std::string prefix;
+
+    // the condition is true if the key `pointer` has the value `value`
+    nlohmann::json::json_pointer pointer;
+    std::string value;
+
+    // `required` and `optional` schemas of the condition as written in the
+    // schema file, e.g. "aSchema bSchema"
+    std::string required;
+    std::string optional;
+};
+
+
+// Compiled form of a schema file. The flattened schema is parsed once, so
+// that the validation can look up keys instead of searching the whole
+// schema. An index is not modified after construction, so it can be shared
+// by many `YjSchema` objects, also across threads.
+class YjSchemaIndex
+{
+public:
+
+    // Compiles the flattened schema `flat_schema`.
+    explicit YjSchemaIndex(
+        const nlohmann::json& flat_schema);
+
+
+    // Returns the index in the binary schema format, which can be loaded with
+    // `from_binary` without parsing and compiling the schema file again.
+    // The format depends on `ECB_SCHEMA_BINARY_VERSION` only, numbers are
+    // written in little endian byte order, so a binary schema can be used on
+    // any machine.
+    std::string to_binary() const;
+
+
+    // Loads an index from `binary`, which was returned by `to_binary`. The
+    // tables are decoded and rebuilt in memory, they are not used in place,
+    // but no JSON text is parsed and the schema is not flattened or compiled.
+    // Throws an exception if `binary` is damaged or has another version.
+    static YjSchemaIndex from_binary(
+        std::string_view binary);
+
+
+    // Returns true if `content` is in the binary schema format, i.e. starts
+    // with the signature written by `to_binary`.
+    static bool is_binary(
+        std::string_view content);
+
+
+    // Appends the definitions of the key `json_key` (format "/a/b/c") to
+    // `definitions`. Appends nothing if the key is not defined.
+    void append_definitions(
+        const std::string& json_key,
+        std::vector<const YjKeyDefinition*>& definitions) const;
+
+
+    // Returns the definitions of `key` (format "a.b.c") in the order of the
+    // schema file. The returned list is empty if the key is not defined.
+    std::vector<const YjKeyDefinition*> find_key(
+        const std::string& key) const;
+
+
+    // Returns the definitions of all keys of `schema` in the order of the
+    // schema file. The returned list is empty if the schema has no keys.
+    std::vector<const YjKeyDefinition*> get_schema_keys(
+        const std::string& schema) const;
+
+
+    // Returns the identifier of `schema`, or nullptr if the schema defines
+    // no identifier.
+    const std::string* get_identifier(
+        const std::string& schema) const;
+
+
+    // Returns the conditions of `grand_schema` in the order of the schema
+    // file.
+    const std::vector<YjGrandSchemaCondition>& get_grand_schema_conditions(
+        const std::string& grand_schema) const;
+
+
+    // Returns true if the configuration key `json_key` (format "/a/b/c") is
+    // defined in any schema of the schema file, or is a parent of a defined
+    // key. Array indices are wildcards, e.g. "/drive/error/0" is valid if
+    // `drive.error` is defined. Keys below the identifier of a schema with
+    // `allowAnySubkey=true` are always valid. Takes O(length of `json_key`).
+    bool is_valid_key(
+        const std::string& json_key) const;
+
+private:
+    // all definitions in the order of the schema file, so pointers to the
+    // definitions can be sorted by address to get the schema file order
+    std::vector<YjKeyDefinition> definitions_;
+
+    // indices into `definitions_`, key is the JSON pointer of the key
+    std::unordered_map<std::string, std::vector<size_t>> keys_;
+
+    // first and last index + 1 into `definitions_`, key is the schema name
+    std::unordered_map<std::string, std::pair<size_t, size_t>> schemas_;
+
+    std::unordered_map<std::string, std::string> identifiers_;
+
+    // JSON pointers of all defined keys and their parents, and of the
+    // identifiers of schemas with `allowAnySubkey=true`
+    std::unordered_set<std::string> valid_keys_;
+    std::unordered_set<std::string> any_subkey_prefixes_;
+    std::map<std::string, std::vector<YjGrandSchemaCondition>> grand_schemas_;
+
+    // Empty index, filled by `from_binary`.
+    YjSchemaIndex() = default;
+
+    // Fills `keys_`, `schemas_` and `valid_keys_` from `definitions_`.
+    void index_definitions();
+
+    // Adds the attribute `attribute` of `key` in `schema` with the given
+    // value to the index. `is_element` is true if the attribute is a list
+    // and `value` is one of its elements.
+    void add_attribute(
+        const std::string& schema,
+        const std::string& key,
+        const std::string& attribute,
+        bool is_element,
+        const std::string& flat_key,
+        const nlohmann::json& value);
+};
+}
+
+#endif // _YJ_SCHEMA_INDEX_H_
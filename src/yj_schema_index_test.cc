@@ -0,0 +1,240 @@
+//
+// ECB - tests for yj_schema_index module
+//
+// Copyright (C) 2025, Felix Maier <felix.maier@psi.ch>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+#include "nlohmann/json.hpp"
+
+#include "yj_schema_index.h"
+
+using nlohmann::json;
+using namespace ecb;
+
+class YjSchemaIndexFixture : public testing::Test
+{
+protected:
+
+    YjSchemaIndexFixture()
+    {
+        j1 = json();
+    }
+
+    YjSchemaIndex compile(const std::string& schema)
+    {
+        return YjSchemaIndex(json::parse(schema).flatten());
+    }
+
+    json j1;
+};
+
+TEST_F(YjSchemaIndexFixture, keyDefinition)
+{
+    auto dut1 = compile(R"(
+        {
+          "testSchema": {
+            "identifier": "a",
+            "schema": {
+              "a.b": {"type": "boolean integer", "default": 1, "min": 0, "max": 5,
+                      "required": true, "dependencies": "a.c a.d",
+                      "normalize": ["(string=integer) one=1 two=2", "(integer=boolean) 1=true"]},
+              "a.c": {"type": "string"}
+            }
+          }
+        })");
+
+    auto definitions = dut1.find_key("a.b");
+    ASSERT_EQ(definitions.size(), 1);
+
+    const auto* dut2 = definitions[0];
+    EXPECT_TRUE(dut2->schema == "testSchema");
+    EXPECT_TRUE(dut2->key == "a.b");
+    EXPECT_TRUE(dut2->pointer == "/a/b"_json_pointer);
+    EXPECT_TRUE(dut2->type == "boolean integer");
+    ASSERT_EQ(dut2->datatypes.size(), 2);
+    EXPECT_TRUE(dut2->datatypes[0] == YjDatatype::BOOLEAN);
+    EXPECT_TRUE(dut2->datatypes[1] == YjDatatype::INTEGER);
+    EXPECT_TRUE(*dut2->default_value == 1);
+    EXPECT_TRUE(*dut2->min == 0);
+    EXPECT_TRUE(*dut2->max == 5);
+    EXPECT_TRUE(dut2->required);
+
+    ASSERT_EQ(dut2->dependencies.size(), 1);
+    EXPECT_TRUE(dut2->dependencies[0].name == "a.b");
+    EXPECT_TRUE(dut2->dependencies[0].keys == std::vector<std::string>({"a.c", "a.d"}));
+
+    ASSERT_EQ(dut2->normalize.size(), 2);
+    EXPECT_TRUE(dut2->normalize[0].conversion == "(string=integer)");
+    ASSERT_EQ(dut2->normalize[0].values.size(), 2);
+    EXPECT_TRUE(dut2->normalize[0].values[1].first == "two");
+    EXPECT_TRUE(dut2->normalize[0].values[1].second == "2");
+    EXPECT_TRUE(dut2->normalize[1].conversion == "(integer=boolean)");
+
+    EXPECT_TRUE(dut1.find_key("a.c")[0]->default_value.has_value() == false);
+    EXPECT_TRUE(dut1.find_key("a.x").empty());
+    EXPECT_TRUE(*dut1.get_identifier("testSchema") == "a");
+    EXPECT_TRUE(dut1.get_identifier("otherSchema") == nullptr);
+}
+
+TEST_F(YjSchemaIndexFixture, findDefinitions)
+{
+    auto dut1 = compile(R"(
+        {
+          "aSchema": {
+            "schema": {
+              "a.z": {"type": "string"},
+              "a.b": {"type": "string"},
+              "a.b.c": {"type": "integer"}
+            }
+          },
+          "bSchema": {
+            "schema": {
+              "a.b": {"type": "list"}
+            }
+          }
+        })");
+
+    std::vector<const YjKeyDefinition*> dut2;
+    dut1.append_definitions("/a/z", dut2);
+    dut1.append_definitions("/a/b", dut2);
+    dut1.append_definitions("/a/b/c", dut2);
+    dut1.append_definitions("/a/y", dut2);
+
+    // sorted in the order of the flattened schema file, "a.b.c/" < "a.b/"
+    std::sort(dut2.begin(), dut2.end());
+    ASSERT_EQ(dut2.size(), 4);
+    EXPECT_TRUE((dut2[0]->schema == "aSchema") && (dut2[0]->key == "a.b.c"));
+    EXPECT_TRUE((dut2[1]->schema == "aSchema") && (dut2[1]->key == "a.b"));
+    EXPECT_TRUE((dut2[2]->schema == "aSchema") && (dut2[2]->key == "a.z"));
+    EXPECT_TRUE((dut2[3]->schema == "bSchema") && (dut2[3]->key == "a.b"));
+
+    auto dut3 = dut1.get_schema_keys("aSchema");
+    ASSERT_EQ(dut3.size(), 3);
+    EXPECT_TRUE(dut3[2]->key == "a.z");
+    EXPECT_TRUE(dut1.get_schema_keys("cSchema").empty());
+}
+
+TEST_F(YjSchemaIndexFixture, grandSchemaConditions)
+{
+    auto dut1 = compile(R"(
+        {
+          "grandSchema": {
+            "axis": {
+              "axis.type=1": {"required": "aSchema", "optional": "bSchema"},
+              "axis.type=2": {"required": "aSchema"}
+            }
+          }
+        })");
+
+    const auto& dut2 = dut1.get_grand_schema_conditions("axis");
+    ASSERT_EQ(dut2.size(), 2);
+    EXPECT_TRUE(dut2[0].prefix == "/grandSchema/axis/axis.type=1/");
+    EXPECT_TRUE(dut2[0].pointer == "/axis/type"_json_pointer);
+    EXPECT_TRUE(dut2[0].value == "1");
+    EXPECT_TRUE(dut2[1].value == "2");
+    EXPECT_TRUE(dut1.get_grand_schema_conditions("plc").empty());
+}
+
+TEST_F(YjSchemaIndexFixture, validKeys)
+{
+    auto dut1 = compile(R"(
+        {
+          "axisSchema": {
+            "identifier": "axis",
+            "schema": {
+              "axis.id": {"type": "integer"},
+              "drive.error": {"type": "list"}
+            }
+          },
+          "varSchema": {"allowAnySubkey": true, "identifier": "var.any"},
+          "plcSchema": {"allowAnySubkey": false, "identifier": "plc"}
+        })");
+
+    EXPECT_TRUE(dut1.is_valid_key("/axis/id"));
+    EXPECT_TRUE(dut1.is_valid_key("/axis"));
+    EXPECT_TRUE(dut1.is_valid_key("/drive/error/0"));
+    EXPECT_TRUE(dut1.is_valid_key("/drive/error/12/3"));
+    EXPECT_TRUE(dut1.is_valid_key("/var/any/x/y"));
+    EXPECT_TRUE(dut1.is_valid_key("/var/any"));
+
+    // exact matches only
+    EXPECT_FALSE(dut1.is_valid_key("/axis/i"));
+    EXPECT_FALSE(dut1.is_valid_key("/axis/id2"));
+    EXPECT_FALSE(dut1.is_valid_key("/axis/id/x"));
+    EXPECT_FALSE(dut1.is_valid_key("/var/anything"));
+    EXPECT_FALSE(dut1.is_valid_key("/var"));
+    EXPECT_FALSE(dut1.is_valid_key("/plc/x"));
+    EXPECT_FALSE(dut1.is_valid_key("/schema/axis/id"));
+}
+
+TEST_F(YjSchemaIndexFixture, binary)
+{
+    auto dut1 = compile(R"(
+        {
+          "grandSchema": {"axis": {"axis.type=1": {"required": "aSchema", "optional": "bSchema"}}},
+          "aSchema": {
+            "identifier": "a",
+            "schema": {
+              "a.b": {"type": "boolean integer", "default": [1, 2], "min": 0, "max": 5.5,
+                      "required": true, "dependencies": "a.c a.d",
+                      "normalize": ["(string=integer) one=1 two=2"]},
+              "a.c": {"type": "string"}
+            }
+          },
+          "bSchema": {"identifier": "b", "allowAnySubkey": true}
+        })");
+
+    const std::string binary = dut1.to_binary();
+    EXPECT_TRUE(YjSchemaIndex::is_binary(binary));
+
+    // the version is written in little endian byte order on every machine
+    EXPECT_TRUE(binary.compare(8, 4, std::string("\x02\0\0\0", 4)) == 0);
+    EXPECT_FALSE(YjSchemaIndex::is_binary("{\"aSchema\": {}}"));
+
+    auto dut2 = YjSchemaIndex::from_binary(binary);
+    EXPECT_TRUE(dut2.to_binary() == binary);
+
+    auto definitions = dut2.find_key("a.b");
+    ASSERT_EQ(definitions.size(), 1);
+    EXPECT_TRUE(definitions[0]->pointer == "/a/b"_json_pointer);
+    EXPECT_TRUE(definitions[0]->datatypes == std::vector<YjDatatype>({YjDatatype::BOOLEAN,
+            YjDatatype::INTEGER}));
+    EXPECT_TRUE(*definitions[0]->default_value == 1);
+    EXPECT_TRUE(*definitions[0]->max == 5.5);
+    EXPECT_TRUE(definitions[0]->required);
+    EXPECT_TRUE(definitions[0]->dependencies[0].keys == std::vector<std::string>({"a.c", "a.d"}));
+    EXPECT_TRUE(definitions[0]->normalize[0].values[1].second == "2");
+    EXPECT_FALSE(dut2.find_key("a.c")[0]->min.has_value());
+    EXPECT_TRUE(dut2.get_schema_keys("aSchema").size() == 2);
+
+    const auto& conditions = dut2.get_grand_schema_conditions("axis");
+    ASSERT_EQ(conditions.size(), 1);
+    EXPECT_TRUE(conditions[0].pointer == "/axis/type"_json_pointer);
+    EXPECT_TRUE(conditions[0].required == "aSchema");
+    EXPECT_TRUE(conditions[0].optional == "bSchema");
+
+    EXPECT_TRUE(*dut2.get_identifier("bSchema") == "b");
+    EXPECT_TRUE(dut2.is_valid_key("/a/b"));
+    EXPECT_TRUE(dut2.is_valid_key("/b/x"));
+
+    // damaged or of another version
+    EXPECT_THROW(YjSchemaIndex::from_binary(binary.substr(0, binary.size() - 1)), std::runtime_error);
+    std::string other_version = binary;
+    other_version[8] ^= 0x7f;
+    EXPECT_THROW(YjSchemaIndex::from_binary(other_version), std::runtime_error);
+}
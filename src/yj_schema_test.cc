@@ -1025,6 +1025,42 @@ TEST_F(YjSchemaFixture, schema_remove_undefined_keys)
     EXPECT_FALSE(j1.contains("/b/c/d"_json_pointer));
 }
 
+TEST_F(YjSchemaFixture, schema_remove_undefined_keys_structure)
+{
+    schema.str(R"(
+      {
+        "grandSchema": {
+          "abc": {
+            "axis.abc=2": {"required": "axisSchema", "optional": "testSchema"}
+          }
+        },
+        "axisSchema": {"identifier": "axis", "allowAnySubkey": true},
+        "testSchema": {"identifier": "a", "allowAnySubkey": true}
+      })"
+    );
+
+    j1 = json::parse(R"(
+      {
+        "axis": {"abc": 2, "list": [], "map": {}},
+        "a": {"b": [1, 2]},
+        "b": {"c": [1, {"d": 2}]},
+        "list": [{"a": 1}, {"x": 2}, {"y": 3}]
+      })");
+    auto dut1 = YjSchema(schema, "abc");
+
+    EXPECT_NO_THROW(dut1.check_schema("abc", j1));
+    EXPECT_NO_THROW(dut1.remove_undefined_keys(j1));
+
+    // empty lists and objects become null, emptied objects are removed and
+    // removed list items before other items become null
+    EXPECT_TRUE(j1 == json::parse(R"(
+      {
+        "axis": {"abc": 2, "list": null, "map": null},
+        "a": {"b": [1, 2]},
+        "list": [{"a": 1}]
+      })"));
+}
+
 TEST_F(YjSchemaFixture, check_schema_ignore_keys)
 {
     schema.str(R"(
@@ -1297,3 +1333,64 @@ TEST_F(YjSchemaFixture, check_max_range_string)
     j1["/a/b"_json_pointer] = "-1";
     EXPECT_NO_THROW(dut1.check_min_max_ranges(j1));
 }
+
+TEST_F(YjSchemaFixture, validate)
+{
+    schema.str(R"(
+      {
+        "grandSchema": {
+          "axis": {
+            "axis.type=1": {
+              "required": "axisSchema",
+              "optional": "testSchema"
+            }
+          }
+        },
+
+        "axisSchema": {
+          "identifier": "axis",
+          "schema": {
+            "axis.type": {"type": "integer", "default": 1, "normalize": "(string=integer) real=1"},
+            "axis.id": {"type": "integer", "required": true, "min": 0}
+          }
+        },
+
+        "testSchema": {
+          "identifier": "a",
+          "schema": {
+            "a.b": {"type": "string", "default": "x"},
+            "a.c": {"type": "float", "dependencies": "a.b"}
+          }
+        },
+
+        "metaSchema": {
+          "identifier": "meta",
+          "schema": {
+            "meta.schemaNumber": {"type": "integer"}
+          }
+        }
+      })"
+    );
+
+    auto dut1 = YjSchema(schema, "axis");
+
+    j1["/axis/type"_json_pointer] = "Real";
+    j1["/axis/id"_json_pointer] = 3;
+    j1["/a/c"_json_pointer] = 2.5;
+
+    YjValidationResult dut2;
+    EXPECT_NO_THROW(dut2 = dut1.validate(j1));
+    EXPECT_TRUE(j1["/axis/type"_json_pointer] == 1);
+    EXPECT_TRUE(j1["/axis/id"_json_pointer] == 3);
+    EXPECT_TRUE(j1["/a/b"_json_pointer] == "x");
+    EXPECT_TRUE(j1["/a/c"_json_pointer] == 2.5);
+    EXPECT_FALSE(j1.contains("/meta/schemaNumber"_json_pointer));
+    EXPECT_TRUE(dut2.used_schemas == std::vector<std::string>({"axisSchema", "testSchema"}));
+    EXPECT_TRUE(dut2.removed_keys == std::vector<std::string>({"/meta/schemaNumber"}));
+    EXPECT_TRUE(dut2.key_count == 4);
+
+    // the required key axis.id is missing
+    j1.clear();
+    j1["/axis/type"_json_pointer] = 1;
+    EXPECT_THROW(dut1.validate(j1), std::runtime_error);
+}
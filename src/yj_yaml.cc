@@ -19,34 +19,171 @@
 #define RYML_SINGLE_HDR_DEFINE_NOW
 #include <rapidyaml.hpp>
 
+#include <cctype>
+#include <charconv>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <regex>
+#include <optional>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "yj_yaml.h"
 #include "yj_common.h"
+#include "yj_file.h"
+#include "yj_profile.h"
 
 using json = nlohmann::json;
 
+// set by `YjYaml::throw_parse_errors`
+static thread_local bool throw_parse_errors_ = false;
+
+
+[[noreturn]] static void
+throw_yaml_error(const char* msg, size_t length, ryml::Location location, void*)
+{
+    std::string message = "yaml: ";
+
+    if (!location.name.empty())
+        message += std::string(location.name.str, location.name.len) + ":";
+
+    message += std::to_string(location.line) + ": " + std::string(msg, length);
+    message.erase(message.find_last_not_of(" \n") + 1);
+    throw ecb::YjYamlError(message);
+}
+
+// Returns the callbacks for a tree parsed by the calling thread, the tree
+// passes them on to its parser.
+static ryml::Callbacks
+parse_callbacks()
+{
+    if (!throw_parse_errors_)
+        return ryml::get_callbacks();
+
+    return ryml::Callbacks(nullptr, nullptr, nullptr, throw_yaml_error);
+}
+
+
+// Returns `value` as string like `readkey` prints it, or an empty string if
+// it is not a scalar.
+static std::string
+scalar_to_string(const json& value)
+{
+    std::string ret_val;
+
+    if (value.is_string())
+        ret_val = value;
+
+    if (value.is_boolean())
+        ret_val = (value == true) ? "true" : "false";
+
+    if (value.is_number_integer())
+        ret_val = std::to_string(value.get<int>());
+
+    if (value.is_number_unsigned())
+        ret_val = std::to_string(value.get<unsigned int>());
+
+    if (value.is_number_float())
+        ret_val = std::to_string(value.get<double>());
+
+    return ret_val;
+}
+
+// Appends all keys below `value` that have a scalar value to `keys`, in dot
+// notation with the prefix `key`.
+static void
+collect_scalar_keys(const json& value, const std::string& key,
+    std::vector<std::pair<std::string, const json*>>& keys)
+{
+    const std::string prefix = key.empty() ? key : key + ".";
+
+    if (value.is_object())
+    {
+        for (auto it = value.cbegin(); it != value.cend(); ++it)
+            collect_scalar_keys(it.value(), prefix + it.key(), keys);
+    }
+    else if (value.is_array())
+    {
+        for (size_t i = 0; i < value.size(); ++i)
+            collect_scalar_keys(value[i], prefix + std::to_string(i), keys);
+    }
+    else if (!key.empty())
+        keys.emplace_back(key, &value);
+}
+
+// Returns true if `key` matches `pattern`, where `*` matches any sequence of
+// characters.
+static bool
+matches_pattern(const std::string& key, const std::string& pattern)
+{
+    size_t key_pos = 0;
+    size_t pattern_pos = 0;
+
+    // position after the last `*` and the key position it was tried with
+    size_t star_pos = std::string::npos;
+    size_t star_key_pos = 0;
+
+    while (key_pos < key.length())
+    {
+        if ((pattern_pos < pattern.length()) && (pattern[pattern_pos] == '*'))
+        {
+            star_pos = ++pattern_pos;
+            star_key_pos = key_pos;
+        }
+        else if ((pattern_pos < pattern.length()) && (pattern[pattern_pos] == key[key_pos]))
+        {
+            ++pattern_pos;
+            ++key_pos;
+        }
+        else if (star_pos != std::string::npos)
+        {
+            // let the last `*` match one more character
+            pattern_pos = star_pos;
+            key_pos = ++star_key_pos;
+        }
+        else
+            return false;
+    }
+
+    while ((pattern_pos < pattern.length()) && (pattern[pattern_pos] == '*'))
+        ++pattern_pos;
+
+    return pattern_pos == pattern.length();
+}
+
 void
 ecb::YjYaml::read_yaml(const std::string& filename,
     json& json)
 {
-    std::ifstream yaml_content(filename);
+    YjFile yaml_content(filename, YjFileAccess::COPY_ON_WRITE);
 
-    if (!yaml_content)
+    if (!yaml_content.is_open())
         throw std::runtime_error("yaml file not found: " + filename);
 
-    read_yaml(yaml_content, json);
+    // before the content is modified by parsing it in place
+    file_states_.push_back(yj_common::get_file_state(yaml_content));
+    read_bare_yaml(yaml_content.data(), yaml_content.size(), json);
+    process_yaml(json);
+}
+
+const std::vector<nlohmann::json>&
+ecb::YjYaml::get_file_states() const
+{
+    return file_states_;
 }
 
 void
 ecb::YjYaml::read_yaml(std::istream& yaml, json& json)
 {
     read_bare_yaml(yaml, json);
+    process_yaml(json);
+}
 
+void
+ecb::YjYaml::process_yaml(json& json)
+{
     // add ECB metadata
     json::json_pointer meta_ecb_ptr("/meta/ecb");
     json::json_pointer meta_ecb_build_ptr("/meta/ecbBuild");
@@ -59,89 +196,302 @@ ecb::YjYaml::read_yaml(std::istream& yaml, json& json)
     replace_yaml_variables(json);
 }
 
-void
-ecb::YjYaml::replace_yaml_variables(json& json)
+// Variables resolved so far, the key is the JSON pointer of the variable. A
+// variable without value is being resolved, which detects cycles.
+using YjResolvedVariables = std::unordered_map<std::string, std::optional<std::string>>;
+
+// true for the characters of a variable name, the same as `[\w.]`
+static bool
+is_variable_char(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || (c == '_') || (c == '.');
+}
+
+// true for the characters of `\s`
+static bool
+is_space_char(char c)
+{
+    return std::isspace(static_cast<unsigned char>(c));
+}
+
+// Returns the length of the variable `{{ name }}` at the beginning of `text`
+// and sets `name`. Returns 0 if `text` does not start with a variable. This
+// is the same as matching `\{\{\s*([\w.]+)\s*\}\}`.
+static size_t
+parse_variable(std::string_view text, std::string_view& name)
+{
+    size_t pos = 2;
+
+    while ((pos < text.size()) && is_space_char(text[pos]))
+        ++pos;
+
+    const size_t name_start = pos;
+
+    while ((pos < text.size()) && is_variable_char(text[pos]))
+        ++pos;
+
+    if (pos == name_start)
+        return 0;
+
+    name = text.substr(name_start, pos - name_start);
+
+    while ((pos < text.size()) && is_space_char(text[pos]))
+        ++pos;
+
+    if (text.substr(pos, 2) != "}}")
+        return 0;
+
+    return pos + 2;
+}
+
+static const std::string& resolve_variable(const std::string& json_key, const json& data,
+    YjResolvedVariables& resolved);
+
+// Returns `text` with all variables replaced by their values.
+static std::string
+expand_variables(std::string_view text, const json& data, YjResolvedVariables& resolved)
 {
-    const auto REGEX_find_yaml_variable  = std::regex(R"(\{\{\s*([\w.]+)\s*\}\})");
-    const auto REGEX_replace_variable = std::regex(R"((\{\{\s*[\w.]+\s*\}\}))");
-    const auto flattend_json = json.flatten();
-    nlohmann::json patch;
-    std::string replace_value;
-    std::string value;
-    std::string yaml_variable_key;
+    std::string ret_val;
+    ret_val.reserve(text.size());
 
-    for (const auto& el : flattend_json.items())
+    for (size_t pos = 0; pos < text.size();)
     {
-        if (el.value().is_string())
+        const size_t start = text.find("{{", pos);
+
+        if (start == std::string_view::npos)
         {
-            value = el.value();
+            ret_val.append(text, pos);
+            break;
+        }
 
-            for (std::smatch match ; std::regex_search(value, match, REGEX_find_yaml_variable);)
-            {
-                yaml_variable_key = ecb::yj_common::cfg_key_to_json_key_string(match[1].str());
+        std::string_view name;
+        const size_t length = parse_variable(text.substr(start), name);
+
+        if (length == 0)
+        {
+            // not a variable, the next one may start at the second brace
+            ret_val.append(text, pos, start + 1 - pos);
+            pos = start + 1;
+            continue;
+        }
+
+        ret_val.append(text, pos, start - pos);
+        ret_val += resolve_variable(ecb::yj_common::cfg_key_to_json_key_string(std::string(name)),
+                data, resolved);
+        pos = start + length;
+    }
+
+    return ret_val;
+}
+
+// Returns the value of the variable `json_key` with all variables in it
+// replaced. Throws an exception if the variable is not defined, has no value
+// or refers to itself.
+static const std::string&
+resolve_variable(const std::string& json_key, const json& data, YjResolvedVariables& resolved)
+{
+    if (auto it = resolved.find(json_key); it != resolved.end())
+    {
+        if (!it->second.has_value())
+            throw std::runtime_error("yaml: cyclic variable: " + json_key);
+
+        return *it->second;
+    }
+
+    const json::json_pointer pointer(json_key);
 
-                if (flattend_json.contains(yaml_variable_key))
-                {
-                    replace_value = flattend_json[yaml_variable_key];
-                    value = std::regex_replace(value, REGEX_replace_variable, replace_value,
-                            std::regex_constants::format_first_only);
+    if (!data.contains(pointer) || (data.at(pointer).is_structured() && !data.at(pointer).empty()))
+        throw std::runtime_error("yaml: unknown variable: " + json_key);
 
-                    // store new line in patch
-                    patch[el.key()] = value;
-                }
+    const auto& value = data.at(pointer);
+    std::string ret_val;
+
+    if (value.is_string())
+    {
+        resolved.emplace(json_key, std::nullopt);
+        ret_val = expand_variables(value.get_ref<const std::string&>(), data, resolved);
+    }
+    else if (value.is_number() || value.is_boolean())
+        ret_val = value.dump();
+    else
+        throw std::runtime_error("yaml: variable has no value: " + json_key);
+
+    auto& slot = resolved[json_key];
+    slot = std::move(ret_val);
+
+    return *slot;
+}
+
+// Replaces the variables in all strings of `node`, `json_key` is the JSON
+// pointer of `node` in `data`.
+static void
+replace_variables(json& node, std::string& json_key, const json& data, YjResolvedVariables& resolved)
+{
+    const size_t json_key_size = json_key.size();
+
+    if (node.is_string())
+    {
+        if (node.get_ref<const std::string&>().find("{{") != std::string::npos)
+            node = resolve_variable(json_key, data, resolved);
+    }
+    else if (node.is_object())
+    {
+        for (auto& item : node.items())
+        {
+            json_key += '/';
+
+            for (const char c : item.key())
+            {
+                if (c == '~')
+                    json_key += "~0";
+                else if (c == '/')
+                    json_key += "~1";
                 else
-                    throw std::runtime_error("yaml: unknown variable: " + yaml_variable_key);
+                    json_key += c;
             }
+
+            replace_variables(item.value(), json_key, data, resolved);
+            json_key.resize(json_key_size);
         }
     }
-
-    if (patch.empty() == false)
+    else if (node.is_array())
     {
-        patch = patch.unflatten();
-        json.merge_patch(patch);
+        for (size_t i = 0; i < node.size(); ++i)
+        {
+            json_key += '/' + std::to_string(i);
+            replace_variables(node[i], json_key, data, resolved);
+            json_key.resize(json_key_size);
+        }
     }
 }
 
+void
+ecb::YjYaml::replace_yaml_variables(json& json)
+{
+    // no string contains "{{"
+    if (!has_variables_)
+        return;
+
+    YjProfileTimer timer("yaml.variables");
+    YjResolvedVariables resolved;
+    std::string json_key;
+
+    replace_variables(json, json_key, json, resolved);
+}
+
 std::string
 ecb::YjYaml::read_yaml_key(std::istream& yaml,
     const std::string& key)
 {
-    const std::string new_key = ecb::yj_common::cfg_key_to_json_key_string(key);
     json json_data;
-    std::string ret_val;
-    int temp_int;
-    unsigned int temp_uint;
-    double temp_double;
 
     read_bare_yaml(yaml, json_data);
-    auto flatten = json_data.flatten();
 
-    if (flatten.contains(new_key))
+    return get_yaml_key(json_data, key);
+}
+
+std::string
+ecb::YjYaml::get_yaml_key(const json& json_data,
+    const std::string& key)
+{
+    const json* value = find_yaml_key(json_data, key);
+
+    return (value == nullptr) ? std::string() : scalar_to_string(*value);
+}
+
+const json*
+ecb::YjYaml::find_yaml_key(const json& json_data,
+    const std::string& key)
+{
+    if (key.empty())
+        return nullptr;
+
+    const std::string new_key = ecb::yj_common::cfg_key_to_json_key_string(key);
+    nlohmann::json::json_pointer key_ptr;
+
+    try
+    {
+        key_ptr = nlohmann::json::json_pointer(new_key);
+    }
+    catch (const nlohmann::json::exception&)
     {
-        auto x = flatten[new_key];
+        // not a valid key, so it cannot be defined
+        return nullptr;
+    }
 
-        if (x.is_string())
-            ret_val = x;
+    if (!json_data.contains(key_ptr))
+        return nullptr;
 
-        if (x.is_boolean())
-            (x == true) ? ret_val = "true" : ret_val = "false";
+    return &json_data.at(key_ptr);
+}
 
-        if (x.is_number_integer())
+std::vector<ecb::YjKeyValue>
+ecb::YjYaml::select_yaml_keys(std::istream& yaml,
+    const std::vector<std::string>& patterns)
+{
+    json json_data;
+
+    read_bare_yaml(yaml, json_data);
+
+    return select_keys(json_data, patterns);
+}
+
+std::vector<ecb::YjKeyValue>
+ecb::YjYaml::select_yaml_keys(const std::string& filename,
+    const std::vector<std::string>& patterns)
+{
+    YjFile yaml_content(filename, YjFileAccess::COPY_ON_WRITE);
+    json json_data;
+
+    if (!yaml_content.is_open())
+        throw std::runtime_error("yaml file not found: " + filename);
+
+    read_bare_yaml(yaml_content.data(), yaml_content.size(), json_data);
+
+    return select_keys(json_data, patterns);
+}
+
+std::vector<ecb::YjKeyValue>
+ecb::YjYaml::select_keys(const json& json_data,
+    const std::vector<std::string>& patterns)
+{
+    std::vector<YjKeyValue> ret_val;
+    std::unordered_set<std::string> selected_keys;
+
+    // all keys with a scalar value in dot notation, only collected if a
+    // pattern needs them
+    std::vector<std::pair<std::string, const json*>> scalar_keys;
+    bool is_collected = false;
+
+    auto add_key = [&](const std::string& key, const json* value)
+    {
+        if (!selected_keys.insert(key).second)
+            return;
+
+        if (value == nullptr)
+            ret_val.push_back({key, json(), ""});
+        else
+            ret_val.push_back({key, *value, scalar_to_string(*value)});
+    };
+
+    for (const auto& pattern : patterns)
+    {
+        if (pattern.find('*') == std::string::npos)
         {
-            temp_int = x;
-            ret_val = std::to_string(temp_int);
+            add_key(pattern, find_yaml_key(json_data, pattern));
+            continue;
         }
 
-        if (x.is_number_unsigned())
+        if (!is_collected)
         {
-            temp_uint = x;
-            ret_val = std::to_string(temp_uint);
+            collect_scalar_keys(json_data, "", scalar_keys);
+            is_collected = true;
         }
 
-        if (x.is_number_float())
+        for (const auto& [key, value] : scalar_keys)
         {
-            temp_double = x;
-            ret_val = std::to_string(temp_double);
+            if (matches_pattern(key, pattern))
+                add_key(key, value);
         }
     }
 
@@ -152,66 +502,118 @@ std::string
 ecb::YjYaml::read_yaml_key(const std::string& filename,
     const std::string& key)
 {
-    std::ifstream yaml_content(filename);
+    return read_yaml_keys(filename, {key}).front();
+}
 
-    if (!yaml_content)
+std::vector<std::string>
+ecb::YjYaml::read_yaml_keys(const std::string& filename,
+    const std::vector<std::string>& keys)
+{
+    YjFile yaml_content(filename, YjFileAccess::COPY_ON_WRITE);
+    json json_data;
+    std::vector<std::string> ret_val;
+
+    if (!yaml_content.is_open())
         throw std::runtime_error("yaml file not found: " + filename);
 
-    return read_yaml_key(yaml_content, key);
+    read_bare_yaml(yaml_content.data(), yaml_content.size(), json_data);
+
+    ret_val.reserve(keys.size());
+
+    for (const auto& key : keys)
+        ret_val.push_back(get_yaml_key(json_data, key));
+
+    return ret_val;
 }
 
 std::string
 ecb::YjYaml::update_yaml_key(std::istream& yaml, const std::string& key, const std::string& value)
 {
-    bool is_found = true;
-    ryml::Tree tree = ryml::Tree();
-    size_t sib_id;
-    std::stringstream ret_val;
-    std::vector<std::string> split_key;
+    std::vector<YjKeyUpdate> updates = {{key, value}};
+
+    return update_yaml_keys(yaml, updates);
+}
+
+std::string
+ecb::YjYaml::update_yaml_key(
+    std::string filename, const std::string& key, const std::string& value)
+{
+    std::vector<YjKeyUpdate> updates = {{key, value}};
 
+    return update_yaml_keys(filename, updates);
+}
+
+std::string
+ecb::YjYaml::update_yaml_keys(std::istream& yaml, std::vector<YjKeyUpdate>& updates)
+{
     std::string yamlContent((std::istreambuf_iterator<char> (yaml)),
         std::istreambuf_iterator<char>());
-    ryml::parse_in_place(ryml::to_substr(yamlContent), tree);
 
-    split_key = ecb::yj_common::tokenize(key, ecb::yj_common::REGEX_token_sep_dot);
+    return update_yaml_keys_in_place(yamlContent.data(), yamlContent.size(), updates);
+}
 
-    sib_id = tree.root_id();
+std::string
+ecb::YjYaml::update_yaml_keys(const std::string& filename, std::vector<YjKeyUpdate>& updates)
+{
+    YjFile yaml_content(filename, YjFileAccess::COPY_ON_WRITE);
 
-    for (const std::string& el : split_key)
+    if (!yaml_content.is_open())
+        throw std::runtime_error("yaml file not found: " + filename);
+
+    return update_yaml_keys_in_place(yaml_content.data(), yaml_content.size(), updates);
+}
+
+std::string
+ecb::YjYaml::update_yaml_keys_in_place(char* yaml, size_t size,
+    std::vector<YjKeyUpdate>& updates)
+{
+    ryml::Tree tree = ryml::Tree(parse_callbacks());
+    std::stringstream ret_val;
+
+    ryml::parse_in_place(ryml::substr(yaml, size), &tree);
+
+    for (auto& update : updates)
     {
-        sib_id = tree.find_child(sib_id, ryml::to_csubstr(el));
+        bool is_found = true;
+        size_t sib_id = tree.root_id();
 
-        if (sib_id == ryml::NONE)
+        for (const std::string& el : ecb::yj_common::tokenize(update.key,
+                ecb::yj_common::REGEX_token_sep_dot))
         {
-            is_found = false;
-            break;
+            sib_id = tree.find_child(sib_id, ryml::to_csubstr(el));
+
+            if (sib_id == ryml::NONE)
+            {
+                is_found = false;
+                break;
+            }
         }
-    }
 
-    if (is_found && tree.has_val(sib_id))
-        tree.set_val(sib_id, ryml::to_csubstr(value));
+        if (!is_found)
+            update.status = YjUpdateStatus::NOT_FOUND;
+        else if (!update.value.has_value())
+        {
+            tree.remove(sib_id);
+            update.status = YjUpdateStatus::REMOVED;
+        }
+        else if (!tree.has_val(sib_id))
+            update.status = YjUpdateStatus::NO_VALUE;
+        else
+        {
+            // the value has to live as long as the tree
+            tree.set_val(sib_id, tree.to_arena(ryml::to_csubstr(*update.value)));
+            update.status = YjUpdateStatus::UPDATED;
+        }
+    }
 
     ret_val << tree;
     return ret_val.str();
 }
 
-std::string
-ecb::YjYaml::update_yaml_key(
-    std::string filename, const std::string& key, const std::string& value)
-{
-    std::ifstream yaml_content(filename);
-    std::string ret_val;
-
-    if (!yaml_content)
-        throw std::runtime_error("yaml file not found: " + filename);
-
-    ret_val = update_yaml_key(yaml_content, key, value);
-    return ret_val;
-}
-
 void
 ecb::YjYaml::handle_plc_section(json& json)
 {
+    YjProfileTimer timer("yaml.plc");
     auto plc_file_ptr = json::json_pointer("/plc/file");
     std::vector<std::string> plc_code;
 
@@ -226,9 +628,10 @@ ecb::YjYaml::handle_plc_section(json& json)
         if (std::filesystem::is_regular_file(plc_file))
         {
             is_valid_plc_file = true;
-            std::ifstream plc_file_stream(plc_file);
+            YjFile plc_file_content(filename);
+            file_states_.push_back(yj_common::get_file_state(plc_file_content));
 
-            for (std::string line; std::getline(plc_file_stream, line);)
+            for (std::string line : plc_file_content.get_lines())
             {
                 yj_common::remove_whitespaces(line);
 
@@ -236,6 +639,8 @@ ecb::YjYaml::handle_plc_section(json& json)
                     plc_code.push_back(line);
             }
         }
+        else
+            file_states_.push_back(nullptr);
     }
 
     // if plc.file and plc.code are defined
@@ -256,20 +661,204 @@ ecb::YjYaml::handle_plc_section(json& json)
     if (plc_code.size() > 0)
     {
         if (is_valid_plc_file || (json.contains(plc_code_ptr) && is_valid_plc_file))
+        {
+            // the PLC file may contain variables as well
+            for (const auto& line : plc_code)
+                has_variables_ = has_variables_ || (line.find("{{") != std::string::npos);
+
             json[plc_code_ptr] = plc_code;
+        }
     }
 }
 
+// Stores `scalar` as JSON number in `json` and returns true, if it is a number
+// in JSON syntax. Integers that don't fit into 64 bits are converted to float,
+// like json::parse does.
+static bool
+yaml_number_to_json(ryml::csubstr scalar, json& json)
+{
+    const char* const begin = scalar.str;
+    const char* const end = scalar.str + scalar.len;
+    const char* pos = begin;
+    bool is_integer = true;
+
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    if ((pos != end) && (*pos == '-'))
+        ++pos;
+
+    if ((pos == end) || !std::isdigit(static_cast<unsigned char>(*pos)))
+        return false;
+
+    if (*pos++ != '0')
+    {
+        while ((pos != end) && std::isdigit(static_cast<unsigned char>(*pos)))
+            ++pos;
+    }
+
+    if ((pos != end) && (*pos == '.'))
+    {
+        is_integer = false;
+
+        if ((++pos == end) || !std::isdigit(static_cast<unsigned char>(*pos)))
+            return false;
+
+        while ((pos != end) && std::isdigit(static_cast<unsigned char>(*pos)))
+            ++pos;
+    }
+
+    if ((pos != end) && ((*pos == 'e') || (*pos == 'E')))
+    {
+        is_integer = false;
+
+        if ((++pos != end) && ((*pos == '+') || (*pos == '-')))
+            ++pos;
+
+        if ((pos == end) || !std::isdigit(static_cast<unsigned char>(*pos)))
+            return false;
+
+        while ((pos != end) && std::isdigit(static_cast<unsigned char>(*pos)))
+            ++pos;
+    }
+
+    if (pos != end)
+        return false;
+
+    if (is_integer && (*begin == '-'))
+    {
+        json::number_integer_t value;
+
+        if (std::from_chars(begin, end, value).ec == std::errc())
+        {
+            json = value;
+            return true;
+        }
+    }
+    else if (is_integer)
+    {
+        json::number_unsigned_t value;
+
+        if (std::from_chars(begin, end, value).ec == std::errc())
+        {
+            json = value;
+            return true;
+        }
+    }
+
+    // Floats are parsed by json::parse, which does not depend on the locale.
+    // std::from_chars has no floating point overloads before GCC 11, which
+    // the EPICS builds (deb10, RHEL 8) do not have.
+    json = json::parse(begin, end);
+
+    return true;
+}
+
+// Returns the value of a YAML scalar as JSON value. Quoted scalars are
+// strings, plain scalars are numbers, booleans or null if ryml would emit
+// them unquoted as JSON, and strings otherwise.
+static json
+yaml_scalar_to_json(ryml::csubstr scalar, ryml::NodeType type)
+{
+    if (scalar.len == 0)
+    {
+        if ((scalar.str != nullptr) || (type & (ryml::VALQUO | ryml::VALTAG)))
+            return "";
+
+        return nullptr;
+    }
+
+    if ((type & ryml::VALQUO) || (ryml::scalar_style_json_choose(scalar) & ryml::SCALAR_DQUO))
+        return std::string(scalar.str, scalar.len);
+
+    if (scalar == "true")
+        return true;
+
+    if (scalar == "false")
+        return false;
+
+    if (scalar == "null")
+        return nullptr;
+
+    json ret_val;
+
+    // numbers ryml accepts but JSON does not, e.g. "+1" or ".5", are
+    // rejected by json::parse as before, out of range floats are handled
+    // like before
+    if (!yaml_number_to_json(scalar, ret_val))
+        ret_val = json::parse(scalar.str, scalar.str + scalar.len);
+
+    return ret_val;
+}
+
+// Converts the node `id` of `tree` and all its children to JSON. Sets
+// `has_variables` if a string contains "{{".
+static void
+yaml_node_to_json(const ryml::Tree& tree, ryml::id_type id, ryml::id_type depth, json& json,
+    bool& has_variables)
+{
+    if (depth > ryml::EmitOptions::max_depth_default)
+        throw std::runtime_error("yaml: max depth exceeded");
+
+    if (tree.is_stream(id))
+        throw std::runtime_error("yaml: multiple documents are not supported");
+
+    if (tree.has_val(id))
+    {
+        json = yaml_scalar_to_json(tree.val(id), tree.type(id));
+
+        if (json.is_string() && (json.get_ref<const std::string&>().find("{{") != std::string::npos))
+            has_variables = true;
+    }
+    else if (tree.is_seq(id))
+    {
+        json = json::array();
+
+        for (auto child = tree.first_child(id); child != ryml::NONE; child = tree.next_sibling(child))
+        {
+            json.push_back(nullptr);
+            yaml_node_to_json(tree, child, depth + 1, json.back(), has_variables);
+        }
+    }
+    else if (tree.is_map(id))
+    {
+        json = json::object();
+
+        for (auto child = tree.first_child(id); child != ryml::NONE; child = tree.next_sibling(child))
+        {
+            const auto key = tree.key(child);
+            yaml_node_to_json(tree, child, depth + 1, json[std::string(key.str, key.len)],
+                has_variables);
+        }
+    }
+    else
+        throw std::runtime_error("yaml: empty document");
+}
+
 void
 ecb::YjYaml::read_bare_yaml(std::istream& yaml, nlohmann::json& json)
 {
-    std::stringstream json_content;
     std::string yaml_content((std::istreambuf_iterator<char> (yaml)),
         std::istreambuf_iterator<char>());
-    ryml::Tree tree;
 
-    ryml::parse_in_place(ryml::to_substr(yaml_content), &tree);
-    json_content << ryml::as_json(tree);
+    read_bare_yaml(yaml_content.data(), yaml_content.size(), json);
+}
+
+void
+ecb::YjYaml::read_bare_yaml(char* yaml, size_t size, nlohmann::json& json)
+{
+    YjProfileTimer timer("yaml.read");
+    ryml::Tree tree(parse_callbacks());
+
+    ryml::parse_in_place(ryml::substr(yaml, size), &tree);
+
+    if (tree.empty())
+        throw std::runtime_error("yaml: empty document");
 
-    json = json::parse(json_content);
+    has_variables_ = false;
+    yaml_node_to_json(tree, tree.root_id(), 0, json, has_variables_);
+}
+
+void
+ecb::YjYaml::throw_parse_errors(bool enable)
+{
+    throw_parse_errors_ = enable;
 }
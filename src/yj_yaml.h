@@ -20,9 +20,62 @@
 #define _YJ_YAML_H_
 
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace ecb
 {
+// Thrown by the YAML parsers of a thread for which `YjYaml::throw_parse_errors`
+// was enabled, if the YAML content cannot be parsed.
+class YjYamlError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+
+// A key selected by `YjYaml::select_yaml_keys`.
+struct YjKeyValue
+{
+    // key in dot notation, e.g. "drive.error.0"
+    std::string key;
+
+    // value of the key, null if the key is not defined
+    nlohmann::json value;
+
+    // value as returned by `YjYaml::read_yaml_key`, empty if the key is not
+    // defined
+    std::string text;
+};
+
+
+// Result of a key update, see `YjKeyUpdate`.
+enum class YjUpdateStatus
+{
+    NOT_FOUND,
+    NO_VALUE,
+    UPDATED,
+    REMOVED,
+};
+
+
+// One key to update with `YjYaml::update_yaml_keys`.
+struct YjKeyUpdate
+{
+    // key in dot notation, e.g. "controller.Kp"
+    std::string key;
+
+    // new value of the key, the key is removed if it has no value
+    std::optional<std::string> value;
+
+    // set by `update_yaml_keys`: NOT_FOUND if the key does not exist,
+    // NO_VALUE if the key is a list or an object
+    YjUpdateStatus status = YjUpdateStatus::NOT_FOUND;
+};
+
+
 class YjYaml
 {
 
@@ -40,6 +93,13 @@ public:
         nlohmann::json& json);
 
 
+    // Returns the states of the files read by `read_yaml` so far, the YAML
+    // file and the file in `plc.file`, as they were read (see
+    // `yj_common::get_file_state`). A `plc.file` that could not be read has
+    // the state null.
+    const std::vector<nlohmann::json>& get_file_states() const;
+
+
     // Returns the value of `key` in the YAML content provided in `yaml` or
     // `filename`. If `key` does not exist, the function returns an empty
     // string.
@@ -51,6 +111,30 @@ public:
         const std::string& filename,
         const std::string& key);
 
+    // Returns the values of all `keys` in the YAML file `filename`, in the
+    // order of `keys`. The file is read only once. Keys that do not exist
+    // have an empty string as value.
+    std::vector<std::string> read_yaml_keys(
+        const std::string& filename,
+        const std::vector<std::string>& keys);
+
+
+    // Returns the keys selected by `patterns` and their values from the YAML
+    // content provided in `yaml` or `filename`, which is parsed once. A
+    // pattern is either a key or contains `*`, which matches any sequence of
+    // characters including dots: `drive.error.*` selects all keys below
+    // `drive.error`. A pattern with `*` selects only keys with a scalar
+    // value, sorted by key and list items by index; a key without `*` is
+    // returned even if it is not defined. The keys are returned in the order
+    // of `patterns`, each key only once.
+    std::vector<YjKeyValue> select_yaml_keys(
+        std::istream& yaml,
+        const std::vector<std::string>& patterns);
+
+    std::vector<YjKeyValue> select_yaml_keys(
+        const std::string& filename,
+        const std::vector<std::string>& patterns);
+
 
     // Updates the value of `key` in the YAML content provided in `yaml` or
     // `filename` with `value`.  It returns the modified YAML content as a
@@ -66,13 +150,84 @@ public:
         const std::string& key,
         const std::string& value);
 
+
+    // Applies all `updates` to the YAML content provided in `yaml` or
+    // `filename` and returns the modified YAML content. The content is
+    // parsed and emitted only once. Keys are updated in the order of
+    // `updates` like with `update_yaml_key`, keys that do not exist are not
+    // added. The result of each update is stored in its `status`.
+    std::string update_yaml_keys(
+        std::istream& yaml,
+        std::vector<YjKeyUpdate>& updates);
+
+    std::string update_yaml_keys(
+        const std::string& filename,
+        std::vector<YjKeyUpdate>& updates);
+
+
+    // Reads `yaml` content and stores it in `json`, no additional processing.
+    // The content `yaml` of length `size` is modified while parsing, e.g. the
+    // content of a file opened with `YjFileAccess::COPY_ON_WRITE`.
+    void read_bare_yaml(
+        std::istream& yaml,
+        nlohmann::json& json);
+
+    void read_bare_yaml(
+        char* yaml,
+        size_t size,
+        nlohmann::json& json);
+
+
+    // Makes the YAML parsers of the calling thread throw `YjYamlError` if
+    // `enable` is true, instead of reporting the error with the rapidyaml
+    // callbacks of the process, which abort by default. The callbacks of the
+    // process are not changed, so other users of rapidyaml are not affected.
+    static void throw_parse_errors(
+        bool enable);
+
 private:
 
 
-    // Replaces all occurrences of `{{key}}` in the provided `json` with the
-    // corresponding value of `key`. If no such placeholders are found, the
-    // function returns without modifying `json`. If the key in a placeholder
-    // cannot be found this function throws an exception.
+    // Adds the ECB metadata to `json` and calls the `handle_plc_section` and
+    // `replace_yaml_variables` functions.
+    void process_yaml(nlohmann::json& json);
+
+
+    // Returns the value of `key` in `json_data` as string, or an empty string
+    // if `key` does not exist.
+    std::string get_yaml_key(
+        const nlohmann::json& json_data,
+        const std::string& key);
+
+
+    // Returns the value of `key` in `json_data`, or nullptr if `key` does
+    // not exist.
+    const nlohmann::json* find_yaml_key(
+        const nlohmann::json& json_data,
+        const std::string& key);
+
+
+    // Implements `select_yaml_keys` on the parsed YAML content `json_data`.
+    std::vector<YjKeyValue> select_keys(
+        const nlohmann::json& json_data,
+        const std::vector<std::string>& patterns);
+
+
+    // Implements `update_yaml_keys` on the YAML content `yaml` of length
+    // `size`. The content is modified while parsing.
+    std::string update_yaml_keys_in_place(
+        char* yaml,
+        size_t size,
+        std::vector<YjKeyUpdate>& updates);
+
+
+    // Replaces all occurrences of `{{key}}` in the strings of `json` with the
+    // value of `key`. Variables in the value of `key` are replaced as well.
+    // Each string is scanned once and each variable is resolved once. If no
+    // string contained "{{" when the YAML content was read, the function
+    // returns without looking at `json`. Throws an exception if the key in
+    // a placeholder is not defined or is not a scalar, or if variables refer
+    // to each other in a cycle.
     void replace_yaml_variables(nlohmann::json& json);
 
     // Adds the content of the file defined in `plc.file` to `plc.code`. If
@@ -80,11 +235,12 @@ private:
     // inserted before the content of `plc.code`.
     void handle_plc_section(nlohmann::json& json);
 
-    // Reads `yaml` content and stores it in `json`, no additional processing.
-    void read_bare_yaml(
-        std::istream& yaml,
-        nlohmann::json& json);
+    // true if a string read by `read_bare_yaml` or `handle_plc_section`
+    // contains "{{", see `replace_yaml_variables`
+    bool has_variables_ = true;
 
+    // see `get_file_states`
+    std::vector<nlohmann::json> file_states_;
 };
 }
 
@@ -151,6 +151,45 @@ TEST_F(YjYamlFixture, stringList)
 }
 
 
+TEST_F(YjYamlFixture, scalarTypes)
+{
+    const char* testYaml =
+        "key:\n"
+        "  unsigned: 5\n"
+        "  signed: -5\n"
+        "  float: 1e3\n"
+        "  big: 18446744073709551616\n"
+        "  quoted: \"5\"\n"
+        "  leadingZero: 007\n"
+        "  hex: 0x10\n"
+        "  null: null\n"
+        "  empty:\n"
+        "  emptyQuoted: ''\n"
+        "  tilde: ~\n"
+        "  yes: yes\n"
+        "  list: [true, 1.5, abc]";
+
+    std::stringstream data;
+    data << testYaml;
+
+    EXPECT_NO_THROW(dut1.read_bare_yaml(data, j1));
+    EXPECT_TRUE(j1["/key/unsigned"_json_pointer].is_number_unsigned());
+    EXPECT_TRUE(j1["/key/signed"_json_pointer] == -5);
+    EXPECT_TRUE(j1["/key/signed"_json_pointer].is_number_unsigned() == false);
+    EXPECT_TRUE(j1["/key/float"_json_pointer].is_number_float());
+    EXPECT_TRUE(j1["/key/float"_json_pointer] == 1000.0);
+    EXPECT_TRUE(j1["/key/big"_json_pointer].is_number_float());
+    EXPECT_TRUE(j1["/key/quoted"_json_pointer] == "5");
+    EXPECT_TRUE(j1["/key/leadingZero"_json_pointer] == "007");
+    EXPECT_TRUE(j1["/key/hex"_json_pointer] == "0x10");
+    EXPECT_TRUE(j1["/key/null"_json_pointer].is_null());
+    EXPECT_TRUE(j1["/key/empty"_json_pointer].is_null());
+    EXPECT_TRUE(j1["/key/emptyQuoted"_json_pointer] == "");
+    EXPECT_TRUE(j1["/key/tilde"_json_pointer] == "~");
+    EXPECT_TRUE(j1["/key/yes"_json_pointer] == "yes");
+    EXPECT_TRUE(j1["/key/list"_json_pointer] == json::parse(R"([true, 1.5, "abc"])"));
+}
+
 TEST_F(YjYamlFixture, replaceExistingYamlVariables)
 {
     const char* testYaml =
@@ -185,6 +224,45 @@ TEST_F(YjYamlFixture, replaceNoneExistingYamlVariables)
     EXPECT_THROW(dut1.read_yaml(data, j1), std::runtime_error);
 }
 
+TEST_F(YjYamlFixture, replaceChainedYamlVariables)
+{
+    const char* testYaml =
+        "var:\n"
+        "  name: ax{{ var.id }}\n"
+        "  id: 0{{var.number}}\n"
+        "  number: 7\n"
+        "  list: [\"{{var.name}}\", \"{ {{var.name}}}\", \"{{ var.name }\"]\n"
+        "key: \"{{{var.name}}} {{var.name}}\"\n";
+
+    std::stringstream data;
+    data << testYaml;
+
+    dut1.read_yaml(data, j1);
+    EXPECT_TRUE(j1["/var/name"_json_pointer] == "ax07");
+    EXPECT_TRUE(j1["/var/list"_json_pointer] == json::parse(R"(["ax07", "{ ax07}", "{{ var.name }"])"));
+    EXPECT_TRUE(j1["/key"_json_pointer] == "{ax07} ax07") << "is: " << j1["/key"_json_pointer];
+}
+
+TEST_F(YjYamlFixture, replaceCyclicYamlVariables)
+{
+    const char* testYaml =
+        "var:\n"
+        "  a: x{{var.b}}\n"
+        "  b: y{{var.a}}\n";
+
+    std::stringstream data;
+    data << testYaml;
+
+    EXPECT_THROW(dut1.read_yaml(data, j1), std::runtime_error);
+
+    std::stringstream data2("key: \"{{key}}\"\n");
+    EXPECT_THROW(dut1.read_yaml(data2, j1), std::runtime_error);
+
+    // not a scalar
+    std::stringstream data3("var:\n  a: 1\nkey: \"{{var}}\"\n");
+    EXPECT_THROW(dut1.read_yaml(data3, j1), std::runtime_error);
+}
+
 TEST_F(YjYamlFixture, readYamlKey_string_exist)
 {
     const char* testYaml =
@@ -202,6 +280,36 @@ TEST_F(YjYamlFixture, readYamlKey_string_exist)
     EXPECT_EQ(expect.compare(result), 0) << "result is: " << result;
 }
 
+TEST_F(YjYamlFixture, selectYamlKeys)
+{
+    std::stringstream data;
+    data << "axis:\n"
+         "  id: 3\n"
+         "  name: x\n"
+         "drive:\n"
+         "  error: [a, b, c, d, e, f, g, h, i, j, k]\n"
+         "  enable: true\n";
+
+    auto dut2 = dut1.select_yaml_keys(data, {"axis.id", "axis.unknown", "drive.error.*",
+            "axis.*", "drive.*able"});
+
+    ASSERT_EQ(dut2.size(), 15);
+    EXPECT_TRUE(dut2[0].key == "axis.id");
+    EXPECT_TRUE(dut2[0].value == 3);
+    EXPECT_TRUE(dut2[0].text == "3");
+    EXPECT_TRUE(dut2[1].key == "axis.unknown");
+    EXPECT_TRUE(dut2[1].value.is_null());
+    EXPECT_TRUE(dut2[1].text.empty());
+
+    // list items by index, keys selected before are not repeated
+    EXPECT_TRUE(dut2[2].key == "drive.error.0");
+    EXPECT_TRUE(dut2[12].key == "drive.error.10");
+    EXPECT_TRUE(dut2[12].text == "k");
+    EXPECT_TRUE(dut2[13].key == "axis.name");
+    EXPECT_TRUE(dut2[14].key == "drive.enable");
+    EXPECT_TRUE(dut2[14].text == "true");
+}
+
 TEST_F(YjYamlFixture, readYamlKey_keyDoNotExist)
 {
     const char* testYaml =
@@ -292,6 +400,38 @@ TEST_F(YjYamlFixture, updateKey)
     EXPECT_TRUE(x == expectYaml) << x;
 }
 
+TEST_F(YjYamlFixture, updateYamlKeys)
+{
+    const char* testYaml =
+        "test: abc\n"
+        "key:\n"
+        "  key1: 42.12\n"
+        "  key2: hellotest\n"
+        "  key3: [1, 2]\n"
+        "old: 1";
+
+    const char* expectYaml =
+        "test: xyz\n"
+        "key:\n"
+        "  key1: 1\n"
+        "  key2: hellotest\n"
+        "  key3: [1,2]\n";
+
+    std::vector<YjKeyUpdate> updates = {{"key.key1", "1"}, {"test", "xyz"}, {"key.key9", "2"},
+        {"key.key3", "3"}, {"old", std::nullopt}};
+    std::stringstream data;
+    data << testYaml;
+
+    auto x = dut1.update_yaml_keys(data, updates);
+
+    EXPECT_TRUE(x == expectYaml) << x;
+    EXPECT_TRUE(updates[0].status == YjUpdateStatus::UPDATED);
+    EXPECT_TRUE(updates[1].status == YjUpdateStatus::UPDATED);
+    EXPECT_TRUE(updates[2].status == YjUpdateStatus::NOT_FOUND);
+    EXPECT_TRUE(updates[3].status == YjUpdateStatus::NO_VALUE);
+    EXPECT_TRUE(updates[4].status == YjUpdateStatus::REMOVED);
+}
+
 TEST_F(YjYamlFixture, readPlcFile_fileMissing)
 {
     const char* testYaml =